@@ -4,43 +4,723 @@
  * All rights reserved.
  */
 
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
 #include "Javolution.hpp"
 #include "java/lang/UnsupportedOperationException.hpp"
 #include "java/lang/IllegalArgumentException.hpp"
 
+#ifndef JAVOLUTION_MSVC
+#include <sys/mman.h>
+#endif
+#ifdef JAVOLUTION_FASTHEAP_CHECKED
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include "booster/backtrace.hpp"
+#endif
+#ifdef JAVOLUTION_NUMA
+#include <sched.h>
+#include <numa.h>
+#endif
+
 using namespace java::lang;
 
-Type::atomic_count FastHeap::newCount {-1};
-Type::atomic_count FastHeap::delCount {-1};
+struct FastHeap::Region {
+	char* memory;
+	size_t length;
+	bool locked;
+	Region* next;
+};
+
+FastHeap::Pool FastHeap::pools[FastHeap::MAX_NODES][FastHeap::SIZE_CLASSES];
+Type::Mutex FastHeap::growLock;
+std::atomic<FastHeap::Granule*> FastHeap::arenaMap[1 << (FastHeap::MAP_KEY_BITS - FastHeap::MAP_LEAF_BITS)];
+FastHeap::Region* FastHeap::regions = nullptr;
+bool FastHeap::hugePages = false;
+int FastHeap::hugePageRegionCount = 0;
+Type::int64 FastHeap::lockedSize = 0;
+thread_local FastHeap::Magazine FastHeap::magazines[FastHeap::SIZE_CLASSES]; // Zero-initialized (capacity 0).
+thread_local int FastHeap::magazinesNode = 0;
+
+Type::int8 FastHeap::sizeClassOf[(FastHeap::MAX_BLOCK_SIZE >> FastHeap::GRANULE_SHIFT) + 1];
+std::atomic<Type::int64> FastHeap::systemHeapCount {0};
+size_t FastHeap::maxBlockSize = 0;
+
+std::atomic<Type::int64> FastHeap::magazineHitCount {0};
+std::atomic<Type::int64> FastHeap::magazineMissCount {0};
+
+static const int DEFAULT_GROWTH = 8; // Default maximum size multiplier.
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static const size_t SMALL_PAGE_SIZE = 4096;
+
+namespace {
+
+#ifdef JAVOLUTION_FASTHEAP_CHECKED
+const unsigned char FREE_POISON = 0xDD; // Fills freed blocks.
+#endif
+
+const int GROWER_PERIOD = 1; // Polling period of the background thread in milliseconds.
 
-void** FastHeap::queue = nullptr;
-int FastHeap::queueSize = 0;
-int FastHeap::queueMask = 0;
+Type::Mutex growerLock; // Serializes the start and stop of the background thread.
+std::thread* grower = nullptr; // The background thread (nullptr if not running).
+std::atomic<bool> growerStopping(false);
 
-FastHeap::Block* FastHeap::buffer = nullptr;
-void* FastHeap::bufferFirst = nullptr;
-void* FastHeap::bufferLast = nullptr;
+} // namespace
 
-Type::int64 FastHeap::systemHeapCount = 0;
-size_t FastHeap::blockSize = 0;
-int FastHeap::maxUseCount = 0;
+static int detectNodeCount() {
+#ifdef JAVOLUTION_NUMA
+	if (numa_available() < 0)
+		return 1;
+	int count = numa_max_node() + 1;
+	return (count < FastHeap::MAX_NODES) ? count : FastHeap::MAX_NODES;
+#else
+	return 1;
+#endif
+}
+
+static int currentNode() { // The NUMA node of the CPU the current thread is running on.
+#ifdef JAVOLUTION_NUMA
+	int cpu = sched_getcpu();
+	int node = (cpu >= 0) ? numa_node_of_cpu(cpu) : 0;
+	return ((node > 0) && (node < FastHeap::getNodeCount())) ? node : 0;
+#else
+	return 0;
+#endif
+}
+
+int FastHeap::getNodeCount() {
+	static const int count = detectNodeCount();
+	return count;
+}
+
+void FastHeap::checkSizeClass(int sizeClass) {
+	if ((sizeClass < 0) || (sizeClass >= SIZE_CLASSES))
+		throw IllegalArgumentException("Invalid size class.");
+}
 
-void FastHeap::setSize(int size) {
-	if (size == queueSize) return;
-	if (queueSize != 0)
-		throw UnsupportedOperationException("FastHeap resizing not supported.");
+void FastHeap::setSize(int sizeClass, int size) {
+	checkSizeClass(sizeClass);
 	bool isPowerOf2 = ((size != 0) && !(size & (size - 1)));
 	if (!isPowerOf2)
 		throw IllegalArgumentException("Size should be a power of two.");
-	queueSize = size;
-	queueMask = size - 1;
-	queue = new void*[size];
+	std::lock_guard<Type::Mutex> guard(growLock);
+	int nodes = getNodeCount();
+	Pool& first = pools[0][sizeClass]; // All nodes are sized the same.
+	if (size == first.size) return;
+	if (size < first.size)
+		throw UnsupportedOperationException("FastHeap shrinking not supported.");
+	int maxSize = (first.maxSize != 0) ? first.maxSize
+			: (size <= (1 << 30) / DEFAULT_GROWTH) ? size * DEFAULT_GROWTH : (1 << 30);
+	if (size > maxSize)
+		throw IllegalArgumentException("Size should not exceed the maximum size.");
+	if (first.arenaCount == MAX_ARENAS)
+		throw UnsupportedOperationException("FastHeap maximum number of arenas reached.");
+	for (int node = 0; node < nodes; ++node) {
+		Pool& pool = pools[node][sizeClass];
+		if (pool.size == 0) { // First arena.
+			pool.node = node;
+			pool.sizeClass = sizeClass;
+			pool.maxSize = maxSize;
+			pool.arenaSize = size;
+		}
+		if ((size > pool.size) && !addArena(pool, size - pool.size))
+			throw UnsupportedOperationException("FastHeap arena outside of the mapped address range.");
+	}
+	if (maxBlockSize != 0) // Enabled.
+		updateSizeClasses();
+}
 
-	buffer = new Block[size];
-	bufferFirst = &buffer[0];
-	bufferLast = &buffer[size - 1];
+void FastHeap::setMaxSize(int sizeClass, int maxSize) {
+	checkSizeClass(sizeClass);
+	bool isPowerOf2 = ((maxSize != 0) && !(maxSize & (maxSize - 1)));
+	if (!isPowerOf2)
+		throw IllegalArgumentException("Maximum size should be a power of two.");
+	std::lock_guard<Type::Mutex> guard(growLock);
+	Pool& first = pools[0][sizeClass];
+	if (maxSize == first.maxSize) return;
+	if (first.size != 0)
+		throw UnsupportedOperationException("FastHeap maximum size should be set before its size.");
+	for (int node = 0; node < MAX_NODES; ++node) {
+		pools[node][sizeClass].maxSize = maxSize;
+	}
+}
 
-	for (int i = 0; i < size; ++i) {
-		queue[i] = &buffer[i];
+void FastHeap::setHighWaterMark(int sizeClass, int usage, HighWaterCallback callback) {
+	checkSizeClass(sizeClass);
+	for (int node = 0; node < MAX_NODES; ++node) {
+		Pool& pool = pools[node][sizeClass];
+		pool.highWaterCallback = callback;
+		pool.highWaterMark = usage;
+		pool.highWaterReached = false;
 	}
 }
+
+void FastHeap::enable() {
+	if (maxBlockSize != 0) // Already enabled.
+		return;
+	bool isSized = false;
+	for (int i = 0; i < SIZE_CLASSES; ++i) {
+		isSized |= (pools[0][i].size != 0);
+	}
+	if (!isSized) // Size not set.
+		setSize(1024 * 1024);
+	systemHeapCount = 0;
+	for (int node = 0; node < MAX_NODES; ++node) {
+		for (int i = 0; i < SIZE_CLASSES; ++i) {
+			Pool& pool = pools[node][i];
+			pool.maxUseCount = 0;
+			pool.systemHeapCount = 0;
+			pool.highWaterReached = false;
+			pool.remoteFreeCount = 0;
+		}
+	}
+	magazineHitCount = 0;
+	magazineMissCount = 0;
+	if (hugePages) {
+		std::lock_guard<Type::Mutex> guard(growLock);
+		for (Region* region = regions; region != nullptr; region = region->next) {
+			lockRegion(*region);
+		}
+	}
+	updateSizeClasses();
+}
+
+void FastHeap::updateSizeClasses() { // All nodes have the same size classes.
+	Pool* pool = pools[0];
+	int sizeClass = SIZE_CLASSES - 1;
+	while (pool[sizeClass].size == 0) // Largest sized class.
+		--sizeClass;
+	for (int i = (int) (MAX_BLOCK_SIZE >> GRANULE_SHIFT); i >= 0; --i) {
+		for (int j = sizeClass - 1; (j >= 0) && ((size_t) i << GRANULE_SHIFT <= getBlockSize(j)); --j) {
+			if (pool[j].size != 0)
+				sizeClass = j;
+		}
+		sizeClassOf[i] = (Type::int8) sizeClass;
+	}
+	size_t max = 0;
+	for (int i = 0; i < SIZE_CLASSES; ++i) {
+		if (pool[i].size != 0)
+			max = getBlockSize(i);
+	}
+	maxBlockSize = max;
+}
+
+void FastHeap::setBackgroundGrowth(Type::boolean value) {
+	std::lock_guard<Type::Mutex> guard(growerLock);
+	if (value == (grower != nullptr))
+		return;
+	if (value) {
+		growerStopping = false;
+		grower = new std::thread(growInBackground);
+	} else {
+		growerStopping = true;
+		grower->join();
+		delete grower;
+		grower = nullptr;
+	}
+}
+
+Type::boolean FastHeap::isBackgroundGrowth() {
+	std::lock_guard<Type::Mutex> guard(growerLock);
+	return grower != nullptr;
+}
+
+int FastHeap::nextArenaSize(const Pool& pool) {
+	int remaining = pool.maxSize - pool.size;
+	if (pool.arenaCount >= MAX_ARENAS)
+		return 0;
+	return ((pool.arenaSize < remaining) && (pool.arenaCount < MAX_ARENAS - 1)) ? pool.arenaSize : remaining;
+}
+
+bool FastHeap::grow(Pool& pool) {
+	if ((pool.size >= pool.maxSize) || !growLock.try_lock()) // Full or already growing (never waits).
+		return false;
+	int size = nextArenaSize(pool);
+	bool grown = (size > 0) && addArena(pool, size);
+	if ((size > 0) && !grown) // Cannot grow anymore, the system heap is used once exhausted.
+		pool.maxSize = pool.size;
+	growLock.unlock();
+	return grown;
+}
+
+void FastHeap::requestGrowth(Pool& pool) {
+	if ((pool.size < pool.maxSize) && !pool.growRequested.load(std::memory_order_relaxed))
+		pool.growRequested.store(true, std::memory_order_relaxed);
+}
+
+void FastHeap::growInBackground() {
+	while (!growerStopping.load(std::memory_order_acquire)) {
+		for (int node = 0; node < MAX_NODES; ++node) {
+			for (int i = 0; i < SIZE_CLASSES; ++i) {
+				Pool& pool = pools[node][i];
+				if (!pool.growRequested.load(std::memory_order_relaxed))
+					continue;
+				{
+					std::lock_guard<Type::Mutex> guard(growLock); // Waits if the pool is being sized or grown.
+					int size = nextArenaSize(pool);
+					if ((size > 0) && !addArena(pool, size)) // Cannot grow anymore.
+						pool.maxSize = pool.size;
+				}
+				pool.growRequested.store(false, std::memory_order_relaxed);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(GROWER_PERIOD));
+	}
+}
+
+bool FastHeap::addArena(Pool& pool, int size) {
+	size_t blockSize = getBlockSize(pool.sizeClass);
+	size_t slotCount = 1; // The queue of the arena, stored after its blocks.
+	while (slotCount < (size_t) size)
+		slotCount <<= 1;
+	size_t queueOffset = (size * blockSize + alignof(Queue) - 1) & ~(alignof(Queue) - 1);
+	size_t slotsOffset = queueOffset + sizeof(Queue);
+	const size_t granule = size_t(1) << ARENA_SHIFT;
+	size_t length = (slotsOffset + slotCount * sizeof(Slot) + granule - 1) & ~(granule - 1);
+	char* arena = allocateRegion(length, pool.node);
+	if (arena == nullptr) // Not mappable.
+		return false;
+	Queue* queue = new (arena + queueOffset) Queue();
+	queue->mask = slotCount - 1;
+	queue->slots = reinterpret_cast<Slot*>(arena + slotsOffset);
+	for (size_t i = 0; i < slotCount; ++i) { // Free for the first round.
+		new (&queue->slots[i].sequence) std::atomic<size_t>(i);
+	}
+	int index = pool.arenaCount;
+	for (size_t key = reinterpret_cast<size_t>(arena) >> ARENA_SHIFT, end = key + (length >> ARENA_SHIFT);
+			key < end; ++key) { // Maps the arena granules.
+		std::atomic<Granule*>& root = arenaMap[key >> MAP_LEAF_BITS];
+		Granule* leaf = root.load(std::memory_order_acquire);
+		if (leaf == nullptr) {
+			leaf = new Granule[1 << MAP_LEAF_BITS];
+			std::memset(leaf, -1, sizeof(Granule) << MAP_LEAF_BITS);
+			root.store(leaf, std::memory_order_release);
+		}
+		Granule& entry = leaf[key & ((1 << MAP_LEAF_BITS) - 1)];
+		entry.pool = (Type::int8) ((pool.node << NODE_SHIFT) | pool.sizeClass);
+		entry.arena = (Type::int8) index;
+	}
+#ifdef JAVOLUTION_FASTHEAP_CHECKED
+	registerArena(pool, arena, size);
+#endif
+	pool.queues[index] = queue;
+	pool.arenaCount.store(index + 1, std::memory_order_release); // Publishes the queue.
+	void* blocks[MAGAZINE_SIZE / 2];
+	for (int i = 0; i < size;) { // Releases the new blocks by batches (same as magazines flush).
+		int n = 0;
+		for (; (n < MAGAZINE_SIZE / 2) && (i < size); ++n, ++i) {
+			blocks[n] = &arena[i * blockSize];
+		}
+		release(pool, blocks, n);
+	}
+	pool.size += size;
+	return true;
+}
+
+bool FastHeap::isMappable(const char* memory, size_t length) {
+	return ((reinterpret_cast<size_t>(memory) + length - 1) >> ARENA_SHIFT >> MAP_KEY_BITS) == 0;
+}
+
+char* FastHeap::allocateRegion(size_t length, int node) {
+	const size_t granule = size_t(1) << ARENA_SHIFT;
+	length = (length + granule - 1) & ~(granule - 1);
+	char* memory = nullptr;
+	bool isHuge = false;
+#ifndef JAVOLUTION_MSVC
+	if (hugePages) {
+		size_t hugeLength = (length + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+		void* ptr = mmap(nullptr, hugeLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if ((ptr != MAP_FAILED) && !isMappable(static_cast<char*>(ptr), hugeLength)) { // E.g. 5-level paging.
+			munmap(ptr, hugeLength);
+			ptr = MAP_FAILED;
+		}
+		if (ptr != MAP_FAILED) {
+			memory = static_cast<char*>(ptr);
+			isHuge = true;
+		}
+#endif
+		if (memory == nullptr) { // No reserved huge pages, requests transparent huge pages (2 MBytes aligned).
+			void* ptr = mmap(nullptr, hugeLength + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+					-1, 0);
+			if ((ptr != MAP_FAILED) && !isMappable(static_cast<char*>(ptr), hugeLength + HUGE_PAGE_SIZE)) {
+				munmap(ptr, hugeLength + HUGE_PAGE_SIZE);
+				ptr = MAP_FAILED;
+			}
+			if (ptr != MAP_FAILED) {
+				size_t address = (reinterpret_cast<size_t>(ptr) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+				memory = reinterpret_cast<char*>(address);
+#ifdef MADV_HUGEPAGE
+				isHuge = (madvise(memory, hugeLength, MADV_HUGEPAGE) == 0);
+#endif
+			}
+		}
+		if (memory != nullptr)
+			length = hugeLength;
+	}
+#endif
+	if (memory == nullptr) {
+		char* raw = new char[length + granule]; // Never deleted.
+		if (!isMappable(raw, length + granule)) {
+			delete[] raw;
+			return nullptr;
+		}
+		memory = reinterpret_cast<char*>((reinterpret_cast<size_t>(raw) + granule - 1) & ~(granule - 1));
+	}
+	if (isHuge)
+		++hugePageRegionCount;
+#ifdef JAVOLUTION_NUMA
+	if (getNodeCount() > 1) // Binds the region to its node (before being faulted in).
+		numa_tonode_memory(memory, length, node);
+#else
+	(void) node;
+#endif
+	if (hugePages) { // Pre-faults the region.
+		for (size_t i = 0; i < length; i += SMALL_PAGE_SIZE) {
+			memory[i] = 0;
+		}
+		regions = new Region { memory, length, false, regions };
+		if (maxBlockSize != 0) // Enabled.
+			lockRegion(*regions);
+	}
+	return memory;
+}
+
+void FastHeap::lockRegion(Region& region) {
+	if (region.locked)
+		return;
+#ifndef JAVOLUTION_MSVC
+	region.locked = (mlock(region.memory, region.length) == 0); // Fails if RLIMIT_MEMLOCK is exceeded.
+#endif
+	if (region.locked)
+		lockedSize += region.length;
+}
+
+void* FastHeap::allocateSlow(int sizeClass, size_t size) {
+	Magazine& m = magazines[sizeClass];
+	if (m.capacity == 0) // Also sets the thread node.
+		attach(m);
+	Pool& pool = pools[magazinesNode][sizeClass];
+	for (int retry = 0;; ++retry) {
+		do {
+			if (m.capacity > 0) { // Refills half the magazine.
+				report(m);
+				++magazineMissCount;
+				m.count = reserve(pool, m.blocks, MAGAZINE_SIZE / 2);
+				if (m.count > 0)
+					return m.blocks[--m.count];
+			}
+			void* mem;
+			if (reserve(pool, &mem, 1) != 0)
+				return mem;
+		} while (grow(pool));
+		// Yields to the threads preempted while queuing free blocks or while growing the pool.
+		bool stalled = (pool.freeCount.load(std::memory_order_relaxed) > 0) || (pool.size < pool.maxSize);
+		if (!stalled || (retry == MAX_STALLED_RETRIES))
+			break;
+		std::this_thread::yield();
+	}
+	for (int i = 1; i < MAX_NODES; ++i) { // Borrows from other nodes before falling back to the system heap.
+		void* mem;
+		if (reserve(pools[(magazinesNode + i) % MAX_NODES][sizeClass], &mem, 1) != 0)
+			return mem;
+	}
+	// Heap under-sized (maximum size reached or growing).
+	++pool.systemHeapCount;
+	++systemHeapCount;
+	return ::operator new(size);
+}
+
+void FastHeap::deallocateSlow(int poolId, void* mem) {
+	int sizeClass = poolId & SIZE_CLASS_MASK;
+	Pool& pool = pools[poolId >> NODE_SHIFT][sizeClass];
+	Magazine& m = magazines[sizeClass];
+	if ((m.capacity == 0) && attach(m) && (pool.node == magazinesNode)) {
+		m.blocks[m.count++] = mem;
+		return;
+	}
+	if (pool.node != magazinesNode) { // Returns the block to its home node.
+		++pool.remoteFreeCount;
+		release(pool, &mem, 1);
+		return;
+	}
+	if (m.capacity < 0) { // Thread exiting.
+		release(pool, &mem, 1);
+		return;
+	}
+	report(m); // Flushes half the magazine.
+	++magazineMissCount;
+	m.count -= MAGAZINE_SIZE / 2;
+	release(pool, &m.blocks[m.count], MAGAZINE_SIZE / 2);
+	m.blocks[m.count++] = mem;
+}
+
+int FastHeap::reserve(Pool& pool, void** blocks, int n) {
+	int arenaCount = pool.arenaCount.load(std::memory_order_acquire);
+	int first = pool.queueIndex.load(std::memory_order_relaxed);
+	int count = 0;
+	for (int i = 0, arena = first; (i < arenaCount) && (count < n); ++i, arena = (arena + 1) % arenaCount) {
+		int taken = take(*pool.queues[arena], blocks + count, n - count);
+		if ((taken != 0) && (arena != first)) // The next reservations start from this arena.
+			pool.queueIndex.store(arena, std::memory_order_relaxed);
+		count += taken;
+	}
+	if ((count < n) && (pool.overflow.load(std::memory_order_relaxed) != nullptr))
+		count += takeOverflow(pool, blocks + count, n - count);
+	if (count == 0)
+		return 0;
+	int freeCount = pool.freeCount.fetch_sub(count, std::memory_order_relaxed) - count;
+	if (freeCount < (pool.arenaSize >> 2)) // Grows ahead of time.
+		requestGrowth(pool);
+	int useCount = pool.size - freeCount;
+	int maxUseCount = pool.maxUseCount.load(std::memory_order_relaxed);
+	while ((maxUseCount < useCount)
+			&& !pool.maxUseCount.compare_exchange_weak(maxUseCount, useCount, std::memory_order_relaxed)) {
+	}
+	if (maxUseCount < useCount) { // New maximum.
+		if ((pool.highWaterCallback != nullptr) && (useCount >= pool.highWaterMark)
+				&& !pool.highWaterReached.exchange(true))
+			pool.highWaterCallback(pool.sizeClass, useCount);
+	}
+	return count;
+}
+
+void FastHeap::release(Pool& pool, void* const* blocks, int n) {
+	pool.freeCount.fetch_add(n, std::memory_order_relaxed);
+	requeue(pool, blocks, n);
+}
+
+void FastHeap::requeue(Pool& pool, void* const* blocks, int n) {
+	while (n > 0) { // By runs of blocks from the same arena (whose queue can hold all its blocks).
+		int arena = granuleOf(blocks[0])->arena;
+		int run = 1;
+		while ((run < n) && (granuleOf(blocks[run])->arena == arena))
+			++run;
+		int count = put(*pool.queues[arena], blocks, run);
+		if (count == 0) { // The queue is never full, the slot at the tail is still being taken (rare).
+			void* head = pool.overflow.load(std::memory_order_relaxed);
+			do {
+				*static_cast<void**>(blocks[0]) = head; // Links the free block.
+			} while (!pool.overflow.compare_exchange_weak(head, blocks[0], std::memory_order_release,
+					std::memory_order_relaxed));
+			count = 1;
+		}
+		blocks += count;
+		n -= count;
+	}
+}
+
+int FastHeap::take(Queue& queue, void** blocks, int n) {
+	size_t position = queue.head.load(std::memory_order_relaxed);
+	for (;;) {
+		int count = 0; // The number of consecutive slots holding a block for this round.
+		while ((count < n) && (queue.slots[(position + count) & queue.mask].sequence.load(std::memory_order_acquire)
+				== position + count + 1)) {
+			++count;
+		}
+		if (count == 0) { // Empty or the head block is still being put, unless another thread took it.
+			size_t head = queue.head.load(std::memory_order_relaxed);
+			if (head == position)
+				return 0;
+			position = head;
+			continue;
+		}
+		if (queue.head.compare_exchange_weak(position, position + count, std::memory_order_relaxed)) {
+			for (int i = 0; i < count; ++i) {
+				Slot& slot = queue.slots[(position + i) & queue.mask];
+				blocks[i] = slot.block;
+				slot.sequence.store(position + i + queue.mask + 1, std::memory_order_release); // Free, next round.
+			}
+			return count;
+		}
+	}
+}
+
+int FastHeap::put(Queue& queue, void* const* blocks, int n) {
+	size_t position = queue.tail.load(std::memory_order_relaxed);
+	for (;;) {
+		int count = 0; // The number of consecutive free slots for this round.
+		while ((count < n) && (queue.slots[(position + count) & queue.mask].sequence.load(std::memory_order_acquire)
+				== position + count)) {
+			++count;
+		}
+		if (count == 0) { // Full or the tail slot is still being taken, unless another thread filled it.
+			size_t tail = queue.tail.load(std::memory_order_relaxed);
+			if (tail == position)
+				return 0;
+			position = tail;
+			continue;
+		}
+		if (queue.tail.compare_exchange_weak(position, position + count, std::memory_order_relaxed)) {
+			for (int i = 0; i < count; ++i) {
+				Slot& slot = queue.slots[(position + i) & queue.mask];
+				slot.block = blocks[i];
+				slot.sequence.store(position + i + 1, std::memory_order_release); // Holds a block.
+			}
+			return count;
+		}
+	}
+}
+
+int FastHeap::takeOverflow(Pool& pool, void** blocks, int n) {
+	void* block = pool.overflow.exchange(nullptr, std::memory_order_acquire); // The whole stack (no ABA).
+	int count = 0;
+	while (block != nullptr) {
+		void* next = *static_cast<void**>(block);
+#ifdef JAVOLUTION_FASTHEAP_CHECKED
+		std::memset(block, FREE_POISON, sizeof(void*)); // Restores the poison overwritten by the link.
+#endif
+		if (count < n) {
+			blocks[count++] = block;
+		} else {
+			requeue(pool, &block, 1); // Still free.
+		}
+		block = next;
+	}
+	return count;
+}
+
+FastHeap::MagazineFlusher::~MagazineFlusher() {
+	for (int i = 0; i < SIZE_CLASSES; ++i) {
+		Magazine& m = magazines[i];
+		report(m);
+		release(pools[magazinesNode][i], m.blocks, m.count);
+		m.count = 0;
+		m.capacity = -1;
+	}
+}
+
+bool FastHeap::attach(Magazine& m) {
+	if (m.capacity < 0)
+		return false;
+	static thread_local MagazineFlusher flusher; // Registers the flush at thread exit.
+	(void) flusher;
+	magazinesNode = currentNode();
+	for (int i = 0; i < SIZE_CLASSES; ++i) {
+		magazines[i].capacity = MAGAZINE_SIZE;
+	}
+	return true;
+}
+
+void FastHeap::report(Magazine& m) {
+	if (m.hitCount == 0)
+		return;
+	magazineHitCount += m.hitCount;
+	m.hitCount = 0;
+}
+
+#ifdef JAVOLUTION_FASTHEAP_CHECKED
+
+// Checked mode: each arena block has a state (free, allocated or quarantined) and the backtrace of its
+// last allocation. Freed blocks are poisoned and their reuse is delayed (quarantine) to detect writes after free.
+
+namespace {
+
+enum BlockState {
+	BLOCK_FREE = 0, BLOCK_ALLOCATED, BLOCK_QUARANTINED
+};
+
+const unsigned char NEW_POISON = 0xCD; // Fills allocated blocks (uninitialized memory).
+const int QUARANTINE_SIZE = 4096; // Number of freed blocks whose reuse is delayed.
+
+struct CheckedArena {
+	char* memory;
+	size_t blockSize;
+	int size;
+	int sizeClass;
+	Type::int8* states;
+	booster::backtrace** traces; // Allocation backtraces.
+};
+
+Type::Mutex checkLock; // Guards blocks states and the quarantine.
+std::map<char*, CheckedArena*> checkedArenas; // Ordered by address.
+void* quarantine[QUARANTINE_SIZE];
+int quarantineIndex = 0;
+
+CheckedArena& arenaOf(void* mem) { // The block is known to be in arenas memory.
+	std::map<char*, CheckedArena*>::iterator it = checkedArenas.upper_bound(static_cast<char*>(mem));
+	return *(--it)->second;
+}
+
+bool isPoisoned(void* mem, size_t length) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(mem);
+	for (size_t i = 0; i < length; ++i) {
+		if (bytes[i] != FREE_POISON)
+			return false;
+	}
+	return true;
+}
+
+[[noreturn]] void reportError(const char* error, void* mem, const CheckedArena& arena, size_t index) {
+	std::cerr << "FastHeap: " << error << " (block " << mem << ", size class " << arena.sizeClass << ")" << std::endl;
+	std::cerr << "Detected at:" << std::endl;
+	booster::backtrace().trace(std::cerr);
+	if ((index < (size_t) arena.size) && (arena.traces[index] != nullptr)) {
+		std::cerr << "Allocated at:" << std::endl;
+		arena.traces[index]->trace(std::cerr);
+	}
+	std::abort();
+}
+
+} // namespace
+
+void FastHeap::registerArena(Pool& pool, char* arena, int size) {
+	size_t blockSize = getBlockSize(pool.sizeClass);
+	std::lock_guard<Type::Mutex> guard(checkLock);
+	std::memset(arena, FREE_POISON, size * blockSize);
+	checkedArenas[arena] = new CheckedArena { arena, blockSize, size, pool.sizeClass, new Type::int8[size](),
+			new booster::backtrace*[size]() };
+}
+
+void* FastHeap::allocate(size_t size) {
+	void* mem = allocateBlock(size);
+	if (poolOwning(mem) < 0) // System heap.
+		return mem;
+	std::lock_guard<Type::Mutex> guard(checkLock);
+	CheckedArena& arena = arenaOf(mem);
+	size_t index = (static_cast<char*>(mem) - arena.memory) / arena.blockSize;
+	if (arena.states[index] != BLOCK_FREE)
+		reportError("Block allocated twice, heap corrupted", mem, arena, index);
+	if (!isPoisoned(mem, arena.blockSize))
+		reportError("Write after free", mem, arena, index);
+	arena.states[index] = BLOCK_ALLOCATED;
+	delete arena.traces[index];
+	arena.traces[index] = new booster::backtrace();
+	std::memset(mem, NEW_POISON, arena.blockSize);
+	return mem;
+}
+
+void FastHeap::deallocate(void* mem) {
+	if (poolOwning(mem) < 0) // System heap.
+		return deallocateBlock(mem);
+	void* evicted;
+	{
+		std::lock_guard<Type::Mutex> guard(checkLock);
+		CheckedArena& arena = arenaOf(mem);
+		size_t offset = static_cast<char*>(mem) - arena.memory;
+		size_t index = offset / arena.blockSize;
+		if ((offset % arena.blockSize != 0) || (index >= (size_t) arena.size))
+			reportError("Misaligned free", mem, arena, index);
+		if (arena.states[index] != BLOCK_ALLOCATED)
+			reportError("Double free", mem, arena, index);
+		std::memset(mem, FREE_POISON, arena.blockSize);
+		arena.states[index] = BLOCK_QUARANTINED;
+		evicted = quarantine[quarantineIndex];
+		quarantine[quarantineIndex] = mem;
+		quarantineIndex = (quarantineIndex + 1) % QUARANTINE_SIZE;
+		if (evicted != nullptr) { // Released for reuse.
+			CheckedArena& evictedArena = arenaOf(evicted);
+			size_t evictedIndex = (static_cast<char*>(evicted) - evictedArena.memory) / evictedArena.blockSize;
+			if (!isPoisoned(evicted, evictedArena.blockSize))
+				reportError("Write after free", evicted, evictedArena, evictedIndex);
+			evictedArena.states[evictedIndex] = BLOCK_FREE;
+		}
+	}
+	if (evicted != nullptr)
+		deallocateBlock(evicted);
+}
+
+#endif
@@ -80,32 +80,77 @@ public:
 
 #define INTERFACE(HANDLE_) \
     HANDLE_(Void = nullptr) {} \
-    HANDLE_(Interface* value) : Object(dynamic_cast<Value*>(value)) {}
+    HANDLE_(Interface* value) : Object(dynamic_cast<Value*>(value)) {} \
+    HANDLE_(const HANDLE_&) = default; \
+    HANDLE_(HANDLE_&&) noexcept = default; \
+    HANDLE_& operator=(const HANDLE_&) = default; \
+    HANDLE_& operator=(HANDLE_&&) noexcept = default;
 
 #define INTERFACE_BASE(HANDLE_, BASE_) \
     HANDLE_(Void = nullptr) {} \
-    HANDLE_(Interface* value) : BASE_(value) {}
+    HANDLE_(Interface* value) : BASE_(value) {} \
+    HANDLE_(const HANDLE_&) = default; \
+    HANDLE_(HANDLE_&&) noexcept = default; \
+    HANDLE_& operator=(const HANDLE_&) = default; \
+    HANDLE_& operator=(HANDLE_&&) noexcept = default;
 
 #define INTERFACE_BASE_BASE(HANDLE_, BASE_1, BASE_2) \
     HANDLE_(Void = nullptr) {} \
-    HANDLE_(Interface* value) : BASE_1(value), BASE_2(value) {}
+    HANDLE_(Interface* value) : BASE_1(value), BASE_2(value) {} \
+    HANDLE_(const HANDLE_&) = default; \
+    HANDLE_(HANDLE_&&) noexcept = default; \
+    HANDLE_& operator=(const HANDLE_&) = default; \
+    HANDLE_& operator=(HANDLE_&&) noexcept = default;
 
 #define CLASS(HANDLE_) \
     HANDLE_(Void = nullptr) {} \
-    HANDLE_(Value* value) : Object(value) {}
+    HANDLE_(Value* value) : Object(value) {} \
+    HANDLE_(const HANDLE_&) = default; \
+    HANDLE_(HANDLE_&&) noexcept = default; \
+    HANDLE_& operator=(const HANDLE_&) = default; \
+    HANDLE_& operator=(HANDLE_&&) noexcept = default;
 
 #define CLASS_BASE(HANDLE_, BASE_) \
     HANDLE_(Void = nullptr) {} \
-    HANDLE_(Value* value) : BASE_(value) {}
+    HANDLE_(Value* value) : BASE_(value) {} \
+    HANDLE_(const HANDLE_&) = default; \
+    HANDLE_(HANDLE_&&) noexcept = default; \
+    HANDLE_& operator=(const HANDLE_&) = default; \
+    HANDLE_& operator=(HANDLE_&&) noexcept = default;
 
 #define CLASS_BASE_BASE(HANDLE_, BASE_1, BASE_2) \
     HANDLE_(Void = nullptr) {} \
-    HANDLE_(Value* value) : BASE_1(value), BASE_2(value) {}
+    HANDLE_(Value* value) : BASE_1(value), BASE_2(value) {} \
+    HANDLE_(const HANDLE_&) = default; \
+    HANDLE_(HANDLE_&&) noexcept = default; \
+    HANDLE_& operator=(const HANDLE_&) = default; \
+    HANDLE_& operator=(HANDLE_&&) noexcept = default;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Define Lock-free heap of fixed-size blocks. Real-time systems should ensure that no heap allocation exceeding
-// the block size is ever performed in order to avoid non time-deterministic system heap allocations.
-// The maximum capacity of the FastHeap is about 13/26 GBytes (on 32/64 bits systems).
+// the largest block size is ever performed in order to avoid non time-deterministic system heap allocations.
+// Blocks are segregated in size classes (pools), each holding blocks with a power of two free capacity
+// (from BLOCK_FREE_SIZE / 8 up to BLOCK_FREE_SIZE * 8) plus the object header (virtual table and reference count);
+// an allocation is served by the smallest sized class large enough.
+// The maximum capacity of each size class is about 13/26 GBytes (on 32/64 bits systems).
+// Size classes grow by chained arenas (up to their maximum size) without stopping allocating threads; when
+// background growth is enabled, arenas are added ahead of time by a background thread (when less than a quarter of
+// an arena is free), the allocating thread grows a size class itself only if exhausted. Each arena has its own
+// queue of free blocks sized to the arena (stored at its end). The arena owning a block is found through a radix
+// map indexed by address (1 MBytes granules).
+// Optionally, arenas can be backed by huge pages, pre-faulted and locked in memory to avoid page faults
+// and reduce TLB misses on the hot path.
+// When compiled with JAVOLUTION_FASTHEAP_CHECKED, the heap detects misaligned and double frees and writes to
+// freed blocks (freed blocks are poisoned and quarantined before being reused); errors are reported to the
+// standard error stream with the allocation backtrace of the block and the program is aborted.
+// When compiled with JAVOLUTION_NUMA (requires libnuma), size classes are partitioned per NUMA node: threads
+// allocate from the pools of their node, arenas are bound to their node and blocks freed by threads of another
+// node are returned to their home pool.
+// Each thread keeps a small magazine (stack) of free blocks per size class; the shared queue of a class is only
+// accessed when a magazine is empty (allocation) or full (deallocation), in which case half a magazine is exchanged.
+// Shared queues use per-slot sequence numbers and never wait: an allocation finding the head block still being
+// released falls back as if the queue was empty, a block released while its slot is still being taken is pushed on
+// an overflow stack.
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class FastHeap {
@@ -117,91 +162,367 @@ class FastHeap {
         virtual ~Block() {} // Class with virtual support.
     };
 
-    static Type::atomic_count newCount; // Number of block allocated minus one.
-    static Type::atomic_count delCount; // Number of blocks deleted minus one.
+public:
+
+    /** The free block capacity in bytes of the default size class (excludes reference count member). */
+    static const size_t BLOCK_FREE_SIZE = MAX_HANDLES * sizeof(void*);
+
+    /** The number of CPUs per-CPU data is sized for (32); the shared queues of the heap have no such limit. */
+    static const int MAX_CPU = 32;
+
+    /** The block size in bytes of the default size class. */
+    static const size_t BLOCK_SIZE = sizeof(Block);
+
+    /** The number of size classes (7). */
+    static const int SIZE_CLASSES = 7;
+
+    /** The default size class (blocks of BLOCK_SIZE bytes). */
+    static const int DEFAULT_SIZE_CLASS = 3;
+
+    /** The block size in bytes of the largest size class. */
+    static const size_t MAX_BLOCK_SIZE = BLOCK_SIZE - BLOCK_FREE_SIZE
+            + (BLOCK_FREE_SIZE << (SIZE_CLASSES - 1 - DEFAULT_SIZE_CLASS));
+
+#ifdef JAVOLUTION_NUMA
+    /** The maximum number of NUMA nodes (8). */
+    static const int MAX_NODES = 8;
+#else
+    /** The maximum number of NUMA nodes (1 when not compiled with JAVOLUTION_NUMA). */
+    static const int MAX_NODES = 1;
+#endif
+
+    /** Callback invoked when the number of blocks used by a size class reaches its high-water mark. */
+    typedef void (*HighWaterCallback)(int sizeClass, int usage);
+
+private:
 
-    static void** queue; // Circular queue of memory blocks.
-    static int queueSize; // Size of the queue (power of 2).
-    static int queueMask; // Mask (size -1)
+    static const int GRANULE_SHIFT = 3; // Block sizes are multiple of 8 bytes.
+    static const int NODE_SHIFT = 3; // Pools identifiers are (node << NODE_SHIFT) | sizeClass.
+    static const int SIZE_CLASS_MASK = (1 << NODE_SHIFT) - 1;
+
+    struct Slot { // Queue slot; its sequence tells whether it is free or holds a block for the current round.
+        std::atomic<size_t> sequence;
+        void* block;
+    };
+    struct Queue { // Lock-free bounded queue of free blocks with per-slot sequence numbers (Vyukov).
+        std::atomic<size_t> head; // Position of the next block taken.
+        std::atomic<size_t> tail; // Position of the next block put.
+        size_t mask; // Number of slots minus one.
+        Slot* slots;
+    };
+    static const int MAX_ARENAS = 64; // Per pool (the last arena holds all the blocks up to the maximum size).
+    struct Pool { // Lock-free pool of blocks of the same size class (and NUMA node).
+        int node;
+        int sizeClass;
+        Queue* queues[MAX_ARENAS]; // The free blocks of each arena.
+        std::atomic<int> queueIndex; // The arena the next blocks are taken from first.
+        std::atomic<int> freeCount; // Number of free blocks in the queues (or overflow).
+        std::atomic<void*> overflow; // Stack of the blocks released while their queue slot was still being taken.
+        std::atomic<int> size; // Number of blocks in all arenas.
+        int maxSize; // Maximum number of blocks (0 if not set).
+        int arenaSize; // Number of blocks added when growing.
+        std::atomic<int> arenaCount; // Number of arenas.
+        std::atomic<int> maxUseCount;
+        std::atomic<Type::int64> systemHeapCount; // Number of system heap allocations of this size class when enabled.
+        std::atomic<bool> growRequested; // Set until the background thread (if enabled) has grown the pool.
+        int highWaterMark;
+        HighWaterCallback highWaterCallback;
+        std::atomic<bool> highWaterReached;
+        std::atomic<Type::int64> remoteFreeCount; // Blocks returned by threads of other nodes.
+    };
+    static Pool pools[MAX_NODES][SIZE_CLASSES];
+    static Type::Mutex growLock; // Serializes arenas creation.
+
+    static const int ARENA_SHIFT = 20; // Arenas are made of 1 MBytes aligned granules.
+    static const int MAP_KEY_BITS = ((sizeof(void*) > 4) ? 48 : 32) - ARENA_SHIFT; // Virtual address bits.
+    static const int MAP_LEAF_BITS = MAP_KEY_BITS / 2;
+    struct Granule { // Arena map entry (-1 if not in arenas).
+        Type::int8 pool;
+        Type::int8 arena; // The index of the arena in its pool.
+    };
+    static std::atomic<Granule*> arenaMap[1 << (MAP_KEY_BITS - MAP_LEAF_BITS)];
+
+    struct Region; // Memory region (arena or queue) locked in memory when huge pages are used.
+    static Region* regions;
+    static bool hugePages;
+    static int hugePageRegionCount;
+    static Type::int64 lockedSize;
+
+    static const int MAGAZINE_SIZE = 32; // Maximum number of free blocks cached per thread and size class.
+    static const int MAX_STALLED_RETRIES = 64; // Yields before using the system heap while other threads free or grow.
+    struct Magazine { // Thread-local stack of free blocks (trivially destructible, flushed at thread exit).
+        void* blocks[MAGAZINE_SIZE];
+        int count; // Number of free blocks held.
+        int capacity; // 0 before first use, -1 after thread exit (shared queue only), else MAGAZINE_SIZE.
+        Type::int64 hitCount; // Number of hits not yet reported to magazineHitCount.
+    };
+    static thread_local Magazine magazines[SIZE_CLASSES];
+    static thread_local int magazinesNode; // The NUMA node of the current thread (when magazines are attached).
+    struct MagazineFlusher { // Returns the magazine blocks to the shared queues when the thread exits.
+        ~MagazineFlusher();
+    };
 
-    static Block* buffer; // Memory buffer.
-    static void* bufferFirst; // Address of first block in buffer.
-    static void* bufferLast; // Address of last block in buffer.
+    static Type::int8 sizeClassOf[(MAX_BLOCK_SIZE >> GRANULE_SHIFT) + 1]; // Smallest sized class by granule.
+    static std::atomic<Type::int64> systemHeapCount; // Number of system heap allocations when enabled (should be zero).
+    static size_t maxBlockSize; // 0 when disabled, else the block size of the largest sized class.
+
+    static std::atomic<Type::int64> magazineHitCount; // Allocations/deallocations served by thread magazines.
+    static std::atomic<Type::int64> magazineMissCount; // Magazine exchanges with the shared queues.
+
+    static void* allocateSlow(int sizeClass, size_t size); // Magazine empty.
+    static void deallocateSlow(int poolId, void* mem); // Magazine full or block from another node.
+    static int reserve(Pool& pool, void** blocks, int n); // Takes up to n blocks from the shared queue (never waits).
+    static void release(Pool& pool, void* const* blocks, int n); // Returns n blocks to the shared queue (never waits).
+    static void requeue(Pool& pool, void* const* blocks, int n); // Puts free blocks back in their arena queue.
+    static int take(Queue& queue, void** blocks, int n); // Takes up to n blocks ready at the head of the queue.
+    static int put(Queue& queue, void* const* blocks, int n); // Puts up to n blocks in the free slots at the tail.
+    static int takeOverflow(Pool& pool, void** blocks, int n); // Takes up to n blocks from the overflow stack.
+    static bool attach(Magazine& m); // Attaches the magazines to the current thread (false after thread exit).
+    static void report(Magazine& m); // Reports magazine hits not yet reported.
+    static void updateSizeClasses(); // Updates sizeClassOf and maxBlockSize (when enabled).
+    static bool grow(Pool& pool); // Adds an arena if possible and not already growing.
+    static void requestGrowth(Pool& pool); // Flags the pool for the background thread (never blocks).
+    static void growInBackground(); // The background thread loop (polls the flagged pools).
+    static int nextArenaSize(const Pool& pool); // The number of blocks of the next arena when growing (0 if full).
+    static bool addArena(Pool& pool, int size); // Returns false if no memory could be mapped.
+    static bool isMappable(const char* memory, size_t length); // Within the address range of the arena map.
+    static char* allocateRegion(size_t length, int node); // 1 MBytes aligned, never deallocated (or nullptr).
+    static void lockRegion(Region& region);
+    static void checkSizeClass(int sizeClass);
+
+    static inline const Granule* granuleOf(const void* mem) { // Returns nullptr if not mapped.
+        size_t key = reinterpret_cast<size_t>(mem) >> ARENA_SHIFT;
+        if ((key >> MAP_KEY_BITS) != 0)
+            return nullptr;
+        const Granule* leaf = arenaMap[key >> MAP_LEAF_BITS].load(std::memory_order_acquire);
+        return (leaf != nullptr) ? &leaf[key & ((1 << MAP_LEAF_BITS) - 1)] : nullptr;
+    }
 
-    static Type::int64 systemHeapCount; // Number of system heap allocations when enabled (should be zero).
-    static size_t blockSize; // 0 when disabled, else BLOCK_SIZE
-    static int maxUseCount;
+    static inline int poolOwning(const void* mem) { // Returns -1 if not allocated from arenas.
+        const Granule* granule = granuleOf(mem);
+        return (granule != nullptr) ? granule->pool : -1;
+    }
 
 public:
 
-    /** The free block capacity in bytes (excludes reference count member). */
-    static const size_t BLOCK_FREE_SIZE = MAX_HANDLES * sizeof(void*);
+    /** Returns the block size in bytes of the specified size class. */
+    static size_t getBlockSize(int sizeClass) {
+        return BLOCK_SIZE - BLOCK_FREE_SIZE + ((BLOCK_FREE_SIZE << sizeClass) >> DEFAULT_SIZE_CLASS);
+    }
 
-    /** The maximum number of CPUs accessing a fast heap instance simultaneously (32). */
-    static const int MAX_CPU = 32; // To avoids newCount and delCount collisions.
+    /** Sets the number of blocks of the specified size class (should be a power of 2). The first call sets the
+     *  arena size (number of blocks added each time the size class grows); subsequent calls can only increase
+     *  the size (by adding arenas) and may be performed while the heap is in use (e.g. upon high-water
+     *  notification by a non time-critical thread).*/
+    static void setSize(int sizeClass, int size);
 
-    /** The block size in bytes. */
-    static const size_t BLOCK_SIZE = sizeof(Block);
+    /** Sets the number of blocks of the default size class (should be a power of 2).*/
+    static void setSize(int size) {
+        setSize(DEFAULT_SIZE_CLASS, size);
+    }
 
-    /** Sets the number of blocks managed by this heap (should be a power of 2).*/
-    static void setSize(int size);
+    /** Sets the maximum number of blocks of the specified size class (should be a power of 2). The size class grows
+     *  automatically until its maximum size is reached (default <code>8 * size</code>): an arena is added by the
+     *  background thread (if enabled) when less than a quarter of an arena is free, or by the allocating thread if
+     *  the size class is exhausted before.
+     *  This method should be called before the size class is sized.*/
+    static void setMaxSize(int sizeClass, int maxSize);
+
+    /** Returns the number of NUMA nodes the heap is partitioned into (1 if NUMA is not supported). Sizes are
+     *  set per node (e.g. <code>setSize(sizeClass, size)</code> allocates <code>size</code> blocks on each node).*/
+    static int getNodeCount();
+
+    /** Returns the number of blocks managed by this heap for the specified size class (all nodes).
+     *  Memory usage is about <code>getSize(sizeClass) * (getBlockSize(sizeClass) + 2 * sizeof(void*))</code>
+     *  (arenas and their queues).*/
+    static int getSize(int sizeClass) {
+        int size = 0;
+        for (int i = 0; i < MAX_NODES; ++i) size += pools[i][sizeClass].size;
+        return size;
+    }
 
-    /** Returns the number of blocks managed by this heap.
-     *  Memory usage is about <code>getSize() * (BLOCK_SIZE + sizeof(void*))</code> */
+    /** Returns the number of blocks of the specified size class on the specified node. */
+    static int getSize(int sizeClass, int node) {
+        return pools[node][sizeClass].size;
+    }
+
+    /** Returns the number of blocks of the default size class. */
     static int getSize() {
-        return queueSize;
+        return getSize(DEFAULT_SIZE_CLASS);
+    }
+
+    /** Returns the maximum number of blocks of the specified size class (per node). */
+    static int getMaxSize(int sizeClass) {
+        return pools[0][sizeClass].maxSize;
+    }
+
+    /** Returns the number of arenas of the specified size class (greater than the number of nodes if the size
+     *  class has grown). */
+    static int getArenaCount(int sizeClass) {
+        int count = 0;
+        for (int i = 0; i < MAX_NODES; ++i) count += pools[i][sizeClass].arenaCount;
+        return count;
+    }
+
+    /** Sets the callback to be invoked (once per node since the heap is enabled) by the allocating thread when the
+     *  number of blocks used by the specified size class on a node reaches the specified value.*/
+    static void setHighWaterMark(int sizeClass, int usage, HighWaterCallback callback);
+
+    /** Sets whether the arenas created from now on are backed by huge pages (false by default).
+     *  Huge pages backed arenas and queues are pre-faulted when created and locked in memory when the heap is
+     *  enabled. If no huge pages are reserved, transparent huge pages are requested instead; on platforms without
+     *  huge pages support, arenas are pre-faulted only.*/
+    static void setHugePages(Type::boolean value) {
+        hugePages = value;
+    }
+
+    /** Indicates if the arenas created are backed by huge pages. */
+    static Type::boolean isHugePages() {
+        return hugePages;
+    }
+
+    /** Returns the number of memory regions (arenas or queues) effectively backed by huge pages. */
+    static int getHugePageRegionCount() {
+        return hugePageRegionCount;
     }
 
-    /** Returns the maximum number of blocks used simultaneously since the heap is enabled.*/
+    /** Returns the number of bytes locked in memory (zero if huge pages are not used or locking failed). */
+    static Type::int64 getLockedSize() {
+        return lockedSize;
+    }
+
+    /** Returns the maximum number of blocks of the specified size class used simultaneously since the heap is
+     *  enabled (blocks cached in thread magazines are counted as used, maximums of all nodes are added).*/
+    static int getMaxUsage(int sizeClass) {
+        int max = 0;
+        for (int i = 0; i < MAX_NODES; ++i) max += pools[i][sizeClass].maxUseCount;
+        return max;
+    }
+
+    /** Returns the maximum number of blocks of the specified size class used simultaneously on the specified node
+     *  since the heap is enabled.*/
+    static int getMaxUsage(int sizeClass, int node) {
+        return pools[node][sizeClass].maxUseCount;
+    }
+
+    /** Returns the maximum number of blocks of the default size class used simultaneously since the heap is
+     *  enabled.*/
     static int getMaxUsage() {
-        return maxUseCount;
+        return getMaxUsage(DEFAULT_SIZE_CLASS);
+    }
+
+    /** Returns the number of system heap allocations performed since the heap is enabled for allocations
+     *  served by the specified size class (the size class is exhausted).*/
+    static Type::int64 getSystemHeapCount(int sizeClass) {
+        Type::int64 count = 0;
+        for (int i = 0; i < MAX_NODES; ++i) count += pools[i][sizeClass].systemHeapCount;
+        return count;
+    }
+
+    /** Returns the number of blocks allocated from the specified node and freed by threads of other nodes
+     *  (returned to their home node) since the heap is enabled.*/
+    static Type::int64 getRemoteFreeCount(int node) {
+        Type::int64 count = 0;
+        for (int i = 0; i < SIZE_CLASSES; ++i) count += pools[node][i].remoteFreeCount;
+        return count;
     }
 
-    /** Returns the number of system heap allocations performed since the heap is enabled.*/
+    /** Returns the number of system heap allocations performed since the heap is enabled (all sizes).*/
     static Type::int64 getSystemHeapCount() {
         return systemHeapCount;
     }
 
-    /** Allocates from buffer if size < BLOCK_SIZE. */
+    /** Returns the number of allocations/deallocations served by the thread magazines without accessing the
+     *  shared queues since the heap is enabled (hits of a thread are reported at its next magazine exchange).*/
+    static Type::int64 getMagazineHitCount() {
+        return magazineHitCount;
+    }
+
+    /** Returns the number of magazine exchanges with the shared queues since the heap is enabled.
+     *  The magazine hit rate is <code>hits / (hits + misses)</code>.*/
+    static Type::int64 getMagazineMissCount() {
+        return magazineMissCount;
+    }
+
+#ifndef JAVOLUTION_FASTHEAP_CHECKED
+
+    /** Allocates from the smallest sized class large enough if any. */
     static inline void* allocate(size_t size) {
-        if (size <= blockSize) {
-            int useCount = newCount - delCount + MAX_CPU;
-            if (useCount < queueSize) {
-                if (maxUseCount <= useCount) maxUseCount = ++useCount;
-                return queue[++newCount & queueMask];
-            } // Else heap under-sized.
-        } // Else size too big.
-        if (blockSize > 0)
-            ++systemHeapCount; // Counts only when enabled.
-        return ::operator new(size);
+        return allocateBlock(size);
     }
 
-    /** Restores to buffer if previously allocated from buffer. */
+    /** Restores to arenas if previously allocated from arenas. */
     static inline void deallocate(void* mem) {
-        if ((mem < bufferFirst) || (mem > bufferLast)) // Not in buffer memory.
-            return ::operator delete(mem);
-        queue[++delCount & queueMask] = mem;
+        deallocateBlock(mem);
     }
 
+#else
+
+    /** Allocates from the smallest sized class large enough if any (checked). */
+    static void* allocate(size_t size);
+
+    /** Restores to arenas if previously allocated from arenas (checked). */
+    static void deallocate(void* mem);
+
+#endif
+
     /** Indicates if fast heap allocations are enabled (false by default). */
     static Type::boolean isEnabled() {
-        return (blockSize != 0);
+        return (maxBlockSize != 0);
     }
 
-    /** Enables fast heap allocations. If the heap size is not set, a default heap size of 1024 * 1024 blocks is used.*/
-    static void enable() {
-        if (blockSize != 0) // Already enabled.
-            return;
-        if (queueSize == 0) // Size not set.
-            setSize(1024 * 1024);
-        systemHeapCount = 0;
-        maxUseCount = 0;
-        blockSize = BLOCK_SIZE;
-    }
+    /** Enables fast heap allocations. If no size class is sized, a default heap size of 1024 * 1024 blocks is used
+     *  for the default size class.*/
+    static void enable();
+
+    /** Sets whether arenas are added ahead of time by a background thread (false by default). When enabled, the
+     *  thread polls every millisecond for the size classes having less than a quarter of an arena free and grows
+     *  them; allocating threads never wait for it (they only flag the size class). When disabled, the thread is
+     *  stopped and joined before returning; size classes then grow only when exhausted, by the allocating thread.*/
+    static void setBackgroundGrowth(Type::boolean value);
+
+    /** Indicates if arenas are added ahead of time by a background thread. */
+    static Type::boolean isBackgroundGrowth();
 
     /** Disables buffer allocations. */
     static void disable() {
-        blockSize = 0;
+        maxBlockSize = 0;
     }
 
+private:
+
+    static inline void* allocateBlock(size_t size) {
+        if (size <= maxBlockSize) {
+            int sizeClass = sizeClassOf[(size + (1 << GRANULE_SHIFT) - 1) >> GRANULE_SHIFT];
+            Magazine& m = magazines[sizeClass];
+            if (m.count > 0) {
+                ++m.hitCount;
+                return m.blocks[--m.count];
+            }
+            return allocateSlow(sizeClass, size);
+        } // Else size too big.
+        if (maxBlockSize > 0)
+            ++systemHeapCount; // Counts only when enabled.
+        return ::operator new(size);
+    }
+
+    static inline void deallocateBlock(void* mem) {
+        int poolId = poolOwning(mem);
+        if (poolId < 0) // Not in arenas memory.
+            return ::operator delete(mem);
+        if ((MAX_NODES > 1) && ((poolId >> NODE_SHIFT) != magazinesNode)) // Block from another node.
+            return deallocateSlow(poolId, mem);
+        Magazine& m = magazines[(MAX_NODES > 1) ? poolId & SIZE_CLASS_MASK : poolId];
+        if (m.count < m.capacity) {
+            ++m.hitCount;
+            m.blocks[m.count++] = mem;
+            return;
+        }
+        deallocateSlow(poolId, mem);
+    }
+
+#ifdef JAVOLUTION_FASTHEAP_CHECKED
+    static void registerArena(Pool& pool, char* arena, int size); // Records the blocks states of a new arena.
+#endif
+
 };
@@ -6,6 +6,9 @@
 #pragma once
 
 #include <cstring>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
 #include "java/lang/Object.hpp"
 
 namespace java {
@@ -21,6 +24,11 @@ class System;
  * <p> To support FastHeap allocations/deallocations Array elements are not continuous (fractal structure).
  *     Bulk copies of array elements should be performed using java::lang::System::arraycopy </p>
  *
+ * <p> Arrays smaller than a fractal block hold their elements inline (value sized to the array length rounded
+ *     up to a power of two). Fixed-size arrays of primitives can be flat (contiguous elements allocated through
+ *     the FastHeap, see newFlatInstance). Both representations are transparently upgraded to the fractal structure
+ *     when their length is increased beyond their capacity. </p>
+ *
  * <p> Note: This class implementation is derived from org.javolution.util.FractalArray but optimized for C++.</p>
  *
  * @version 7.0
@@ -31,12 +39,29 @@ public:
     public:
         virtual E& elementAt(int index) = 0;
         virtual const E& elementAt(int index) const = 0;
+        /** Returns the address of the element at the specified index and sets the number of elements stored
+         *  contiguously from that address (at least one). */
+        virtual E* segmentAt(int index, int& count) = 0;
+        virtual const E* segmentAt(int index, int& count) const = 0;
         virtual Value* setLength(int length) = 0;
         virtual Value* clone() const = 0;
+    protected:
+        Value() {
+        }
+        explicit Value(RefCounting counting) :
+                Object::Value(counting) {
+        }
     };
 
     CLASS(Array)
 
+    /** The capacity of fractal leaf blocks; segments boundaries are always multiples of this size (segments of
+     *  flat arrays are longer, see <code>forEachSegment</code>). */
+    static const int SEGMENT_SIZE = (FastHeap::BLOCK_FREE_SIZE / sizeof(E) >= 256) ? 256 :
+            (FastHeap::BLOCK_FREE_SIZE / sizeof(E) >= 128) ? 128 : (FastHeap::BLOCK_FREE_SIZE / sizeof(E) >= 64) ? 64 :
+            (FastHeap::BLOCK_FREE_SIZE / sizeof(E) >= 32) ? 32 : (FastHeap::BLOCK_FREE_SIZE / sizeof(E) >= 16) ? 16 :
+            (FastHeap::BLOCK_FREE_SIZE / sizeof(E) >= 8) ? 8 : 4;
+
     /** The length property of the array which can be set (for non-const arrays) without
      *  modifying the capacity of the array. To adjust the capacity to the length, the method
      *  setLength should be used. */
@@ -55,8 +80,25 @@ public:
      * @throws NegativeArraySizeException if the specified length is negative
      */
     static Array<E> newInstance(int length) {
-        Array<E> tmp = new BlockValue();
-        tmp.setLength(length);
+        if (length < 0)
+             Object::Exceptions::throwNegativeArraySizeException();
+        Array<E> tmp = SmallValue<1>::newValue(length);
+        tmp.length = length;
+        return tmp;
+    }
+
+    /**
+     *  Returns a flat array of specified length (contiguous elements allocated through the FastHeap, from the
+     *  system heap if larger than the largest block). Flat arrays are intended for large arrays of primitives which
+     *  are never resized; they are converted to fractal arrays if their length is increased.
+     *
+     * @throws NegativeArraySizeException if the specified length is negative
+     */
+    static Array<E> newFlatInstance(int length) {
+        if (length < 0)
+             Object::Exceptions::throwNegativeArraySizeException();
+        Array<E> tmp = new FlatValue(length);
+        tmp.length = length;
         return tmp;
     }
 
@@ -98,7 +140,45 @@ public:
              Object::Exceptions::throwNegativeArraySizeException();
         Array<E> tmp = this_<Value>()->setLength(newLength);
         tmp.length = newLength;
-        *this = tmp;
+        *this = std::move(tmp);
+    }
+
+    /**
+     * Performs an action for each contiguous segment of elements in the range [start..end[ of this array
+     * (no bounds checks or virtual calls per element). The action is called with the address of the first element
+     * of the segment and the number of elements in the segment.
+     * For example: <code>data.forEachSegment(0, data.length, [&](double* ptr, int n) {
+     *                         for (int i = 0; i < n; ++i) sum += ptr[i]; })</code>
+     *
+     * @throws ArrayIndexOutOfBoundsException if start < 0 or start > end or end > length
+     */
+    template<class Action> void forEachSegment(int start, int end, Action action) {
+        if ((start < 0) || (start > end) || (end > length))
+            Object::Exceptions::throwArrayIndexOutOfBoundsException();
+        Value* array = this_<Value>();
+        while (start < end) {
+            int count;
+            E* segment = array->segmentAt(start, count);
+            if (count > end - start)
+                count = end - start;
+            action(segment, count);
+            start += count;
+        }
+    }
+
+    // const version.
+    template<class Action> void forEachSegment(int start, int end, Action action) const {
+        if ((start < 0) || (start > end) || (end > length))
+            Object::Exceptions::throwArrayIndexOutOfBoundsException();
+        const Value* array = this_<Value>();
+        while (start < end) {
+            int count;
+            const E* segment = array->segmentAt(start, count);
+            if (count > end - start)
+                count = end - start;
+            action(segment, count);
+            start += count;
+        }
     }
 
     /** Consumer function which can be used to iterate over array elements (see <code>forEach</code>). */
@@ -107,8 +187,10 @@ public:
     /** Performs an action for each element of this array.
      *  For example: <code>names.forEach([](const String& name) { System::out.println(name);})</code> */
     void forEach(const Consumer& action) {
-        Value* array = this_<Value>();
-        for (int i=0; i < length; i++) action(array->elementAt(i)); // TBD: Use recursions...
+        forEachSegment(0, length, [&action](E* segment, int count) {
+            for (int i = 0; i < count; ++i)
+                action(segment[i]);
+        });
     }
 
 private:
@@ -121,16 +203,21 @@ private:
     class BlockValue24;
     class BlockValue28;
     class BlockValue32;
+    template<int N> class SmallValue;
+    class FlatValue;
 
     class BlockValue: public Value {
         typedef BlockValue This;
         typedef BlockValue4 Outer;
     public:
 
-        static const size_t SIZE = FastHeap::BLOCK_FREE_SIZE / sizeof(E);
-        static const int SHIFT = (SIZE >= 256) ? 8 : (SIZE >= 128) ? 7 : (SIZE >= 64) ? 6 : (SIZE >= 32) ? 5 :
-                                         (SIZE >= 16) ? 4 : (SIZE >= 8) ? 3 : 2;
-        static const int MAX_CAPACITY = 1 << SHIFT;
+        static Value* newValue(int length) {
+            return (new This())->setLength(length);
+        }
+
+        static const int MAX_CAPACITY = SEGMENT_SIZE;
+        static const int SHIFT = (MAX_CAPACITY == 256) ? 8 : (MAX_CAPACITY == 128) ? 7 : (MAX_CAPACITY == 64) ? 6 :
+                                 (MAX_CAPACITY == 32) ? 5 : (MAX_CAPACITY == 16) ? 4 : (MAX_CAPACITY == 8) ? 3 : 2;
         static const int MASK = MAX_CAPACITY - 1;
 
         E elements[MAX_CAPACITY];
@@ -143,6 +230,16 @@ private:
             return elements[index];
         }
 
+        E* segmentAt(int index, int& count) override {
+            count = MAX_CAPACITY - index;
+            return &elements[index];
+        }
+
+        const E* segmentAt(int index, int& count) const override {
+            count = MAX_CAPACITY - index;
+            return &elements[index];
+        }
+
         Value* setLength(int length) override {
             if (length > MAX_CAPACITY) 
                 return (new Outer(this))->setLength(length);
@@ -181,26 +278,40 @@ private:
 
         Object blocks[16];
 
-        BlockValue4() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+        BlockValue4() {} // Blocks are allocated on demand (see setLength).
         BlockValue4(Inner* block0) { blocks[0] = block0; }
 
         E& elementAt(int index) override {
-            return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+            return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
         }
 
         const E& elementAt(int index) const override {
-            return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+            return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+        }
+
+        E* segmentAt(int index, int& count) override {
+            return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+        }
+
+        const E* segmentAt(int index, int& count) const override {
+            return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
         }
 
         Value* setLength(int length) override {
+            int last = 15; // The last block is the only one which can be partial.
+            while ((last >= 0) && (blocks[last] == nullptr))
+                --last;
             for (int i = 0; i < 16; ++i) {
                 int indexMin = i << Inner::SHIFT; // Included
                 int indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                 if (indexMin < length) {
-					if (blocks[i] == nullptr) 
+					bool created = (blocks[i] == nullptr);
+					if (created)
 						blocks[i] = new Inner();
                     if (indexMax > length)
-                        blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                        blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+                    else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                        blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                 } else { // indexMin >= length,
                     if (blocks[i] == nullptr)
                         break;
@@ -208,7 +319,7 @@ private:
                 }
             }
 			if (length <= Inner::MAX_CAPACITY)
-				return (blocks[0].this_<Inner>())->setLength(length);
+				return (blocks[0].template this_<Inner>())->setLength(length);
 			return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
         }
 
@@ -216,7 +327,7 @@ private:
             This* copy = new This();
             for (int i=0; i < 16; ++i) {
                 if (blocks[i] == nullptr) break;
-                copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
             }
             return copy;
         }
@@ -233,26 +344,40 @@ private:
 
          Object blocks[16];
 
-         BlockValue8() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue8() {} // Blocks are allocated on demand (see setLength).
          BlockValue8(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
              for (int i = 0; i < 16; ++i) {
                  int indexMin = i << Inner::SHIFT; // Included
                  int indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -260,7 +385,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
 	     }
 
@@ -268,7 +393,7 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
@@ -285,26 +410,40 @@ private:
 
          Object blocks[16];
 
-         BlockValue12() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue12() {} // Blocks are allocated on demand (see setLength).
          BlockValue12(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
              for (int i = 0; i < 16; ++i) {
                  int indexMin = i << Inner::SHIFT; // Included
                  int indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -312,7 +451,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
          }
 
@@ -320,7 +459,7 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
@@ -337,26 +476,40 @@ private:
 
          Object blocks[16];
 
-         BlockValue16() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue16() {} // Blocks are allocated on demand (see setLength).
          BlockValue16(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
              for (int i = 0; i < 16; ++i) {
                  int indexMin = i << Inner::SHIFT; // Included
                  int indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -364,7 +517,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
          }
 
@@ -372,7 +525,7 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
@@ -389,26 +542,40 @@ private:
 
          Object blocks[16];
 
-         BlockValue20() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue20() {} // Blocks are allocated on demand (see setLength).
          BlockValue20(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
              for (int i = 0; i < 16; ++i) {
                  int indexMin = i << Inner::SHIFT; // Included
                  int indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -416,7 +583,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
          }
 
@@ -424,7 +591,7 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
@@ -435,32 +602,47 @@ private:
          typedef BlockValue24 This;
          typedef BlockValue28 Outer;
      public:
-         static const int SHIFT = Inner::SHIFT + 4;
-         static const int MASK = (1 << SHIFT) - 1;
-         static const int MAX_CAPACITY = 1 << SHIFT;
+         static const Type::int64 SHIFT = Inner::SHIFT + 4; // Overflows 32 bits for byte-sized elements.
+         static const Type::int64 ONE = 1;
+         static const Type::int64 MASK = (ONE << SHIFT) - 1;
+         static const Type::int64 MAX_CAPACITY = ONE << SHIFT;
 
          Object blocks[16];
 
-         BlockValue24() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue24() {} // Blocks are allocated on demand (see setLength).
          BlockValue24(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
-             for (int i = 0; i < 16; ++i) {
-                 int indexMin = i << Inner::SHIFT; // Included
-                 int indexMax = (i + 1) << Inner::SHIFT; // Excluded.
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
+             for (Type::int64 i = 0; i < 16; ++i) {
+            	 Type::int64 indexMin = i << Inner::SHIFT; // Included
+            	 Type::int64 indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -468,7 +650,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
          }
 
@@ -476,7 +658,7 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
@@ -494,26 +676,40 @@ private:
 
          Object blocks[16];
 
-         BlockValue28() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue28() {} // Blocks are allocated on demand (see setLength).
          BlockValue28(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[index >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[index >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
              for (Type::int64 i = 0; i < 16; ++i) {
             	 Type::int64 indexMin = i << Inner::SHIFT; // Included
             	 Type::int64 indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -521,7 +717,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return (length <= MAX_CAPACITY) ? this : (new Outer(this))->setLength(length);
          }
 
@@ -529,7 +725,7 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
@@ -545,26 +741,40 @@ private:
 
          Object blocks[16];
 
-         BlockValue32() { for (int i = 0; i < 16; ++i) blocks[i] = new Inner(); }
+         BlockValue32() {} // Blocks are allocated on demand (see setLength).
          BlockValue32(Inner* block0) { blocks[0] = block0; }
 		 
 		 E& elementAt(int index) override {
-             return (blocks[((Type::int64)index) >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[((Type::int64)index) >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
          }
 
          const E& elementAt(int index) const override {
-             return (blocks[((Type::int64)index) >> Inner::SHIFT].this_<Inner>())->elementAt(index & Inner::MASK);
+             return (blocks[((Type::int64)index) >> Inner::SHIFT].template this_<Inner>())->elementAt(index & Inner::MASK);
+         }
+
+         E* segmentAt(int index, int& count) override {
+             return (blocks[((Type::int64)index) >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
+         }
+
+         const E* segmentAt(int index, int& count) const override {
+             return (blocks[((Type::int64)index) >> Inner::SHIFT].template this_<Inner>())->segmentAt(index & Inner::MASK, count);
          }
 
          Value* setLength(int length) override {
+             int last = 15; // The last block is the only one which can be partial.
+             while ((last >= 0) && (blocks[last] == nullptr))
+                 --last;
              for (Type::int64 i = 0; i < 16; ++i) {
             	 Type::int64 indexMin = i << Inner::SHIFT; // Included
             	 Type::int64 indexMax = (i + 1) << Inner::SHIFT; // Excluded.
                  if (indexMin < length) {
-					 if (blocks[i] == nullptr)
+					 bool created = (blocks[i] == nullptr);
+					 if (created)
 						 blocks[i] = new Inner();
 					 if (indexMax > length)
-                         blocks[i].this_<Inner>()->setLength(length & Inner::MASK);
+                         blocks[i].template this_<Inner>()->setLength(length & Inner::MASK);
+					 else if (created || (i == last)) // Fills a new block or completes the previously partial one.
+                         blocks[i].template this_<Inner>()->setLength((int) Inner::MAX_CAPACITY);
                  } else { // indexMin >= length,
                      if (blocks[i] == nullptr)
                          break;
@@ -572,7 +782,7 @@ private:
                  }
              }
 			 if (length <= Inner::MAX_CAPACITY)
-				 return (blocks[0].this_<Inner>())->setLength(length);
+				 return (blocks[0].template this_<Inner>())->setLength(length);
 			 return this;
          }
 
@@ -580,12 +790,181 @@ private:
              This* copy = new This();
              for (int i=0; i < 16; ++i) {
                  if (blocks[i] == nullptr) break;
-                 copy->blocks[i] = blocks[i].cast_<Inner>()->clone();
+                 copy->blocks[i] = blocks[i].template cast_<Inner>()->clone();
              }
              return copy;
          }
      };
 
+    /** Copies the first elements of this value into the specified value (at least n elements capacity). */
+    static Value* copyTo(const E* elements, int n, Value* value) {
+        for (int i = 0; i < n;) {
+            int count;
+            E* segment = value->segmentAt(i, count);
+            if (count > n - i)
+                count = n - i;
+            std::copy(elements + i, elements + i + count, segment);
+            i += count;
+        }
+        return value;
+    }
+
+    template<int N> class SmallValue : public Value { // Inline elements (N less than a fractal block capacity).
+        typedef SmallValue<N> This;
+        typedef typename std::conditional<(2 * N < SEGMENT_SIZE), SmallValue<2 * N>, BlockValue>::type Outer;
+    public:
+
+        E elements[N];
+
+        static Value* newValue(int length) { // Smallest value large enough.
+            return (length <= N) ? new This() : Outer::newValue(length);
+        }
+
+        E& elementAt(int index) override {
+            return elements[index];
+        }
+
+        const E& elementAt(int index) const override {
+            return elements[index];
+        }
+
+        E* segmentAt(int index, int& count) override {
+            count = N - index;
+            return &elements[index];
+        }
+
+        const E* segmentAt(int index, int& count) const override {
+            count = N - index;
+            return &elements[index];
+        }
+
+        Value* setLength(int length) override {
+            if (length > N) // Upgrade.
+                return copyTo(elements, N, Outer::newValue(length));
+            bool isFundamental = std::is_fundamental<E>::value;
+            if (!isFundamental) {
+                E none {};
+                for (int i = length; i < N;)
+                    elements[i++] = none; // Ensures dereferencing of non-primitives types (e.g. Objects)
+            }
+            return this;
+        }
+
+        This* clone() const override {
+            This* copy = new This();
+            std::copy(elements, elements + N, copy->elements);
+            return copy;
+        }
+    };
+
+    class FlatValue : public Value { // Contiguous elements (FastHeap block, system heap if larger than blocks).
+        typedef FlatValue This;
+    public:
+
+        E* elements;
+        int capacity;
+
+        FlatValue(int capacity) : elements(newElements(capacity)), capacity(capacity) {
+        }
+
+        ~FlatValue() {
+            for (int i = 0; i < capacity; ++i)
+                elements[i].~E();
+            FastHeap::deallocate(elements);
+        }
+
+        /** Allocates the specified number of value-initialized elements through the FastHeap (the system heap
+         *  allocations of elements larger than the largest block are counted, see FastHeap::getSystemHeapCount). */
+        static E* newElements(int capacity) {
+            E* elements = static_cast<E*>(FastHeap::allocate((capacity > 0 ? capacity : 1) * sizeof(E)));
+            for (int i = 0; i < capacity; ++i)
+                ::new (&elements[i]) E();
+            return elements;
+        }
+
+        E& elementAt(int index) override {
+            return elements[index];
+        }
+
+        const E& elementAt(int index) const override {
+            return elements[index];
+        }
+
+        E* segmentAt(int index, int& count) override {
+            count = capacity - index;
+            return &elements[index];
+        }
+
+        const E* segmentAt(int index, int& count) const override {
+            count = capacity - index;
+            return &elements[index];
+        }
+
+        Value* setLength(int length) override {
+            if (length > capacity) // Converts to fractal array.
+                return copyTo(elements, capacity, BlockValue::newValue(length));
+            bool isFundamental = std::is_fundamental<E>::value;
+            if (!isFundamental) {
+                E none {};
+                for (int i = length; i < capacity;)
+                    elements[i++] = none; // Ensures dereferencing of non-primitives types (e.g. Objects)
+            }
+            return this;
+        }
+
+        This* clone() const override {
+            This* copy = new This(capacity);
+            std::copy(elements, elements + capacity, copy->elements);
+            return copy;
+        }
+    };
+
+public:
+
+    /** Array value whose elements are stored externally and not owned (e.g. static buffers, writable since the
+     *  elements can be modified through the array). Such values can be statically allocated (immortal reference
+     *  counting); they are converted to fractal values if their length is increased. */
+    class ExternalValue final : public Value {
+    public:
+
+        E* elements;
+        int capacity;
+
+        ExternalValue(E* elements, int capacity, Object::Value::RefCounting counting = Object::Value::SHARED) :
+                Value(counting), elements(elements), capacity(capacity) {
+        }
+
+        E& elementAt(int index) override {
+            return elements[index];
+        }
+
+        const E& elementAt(int index) const override {
+            return elements[index];
+        }
+
+        E* segmentAt(int index, int& count) override {
+            count = capacity - index;
+            return &elements[index];
+        }
+
+        const E* segmentAt(int index, int& count) const override {
+            count = capacity - index;
+            return &elements[index];
+        }
+
+        Value* setLength(int length) override {
+            if (length > capacity) // Converts to fractal array.
+                return copyTo(elements, capacity, BlockValue::newValue(length));
+            return this;
+        }
+
+        FlatValue* clone() const override {
+            FlatValue* copy = new FlatValue(capacity);
+            std::copy(elements, elements + capacity, copy->elements);
+            return copy;
+        }
+    };
+
 };
 
 }
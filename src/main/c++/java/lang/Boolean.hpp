@@ -78,7 +78,8 @@ public:
     }
 
     Class getClass() const {
-          return Class::forName("java::lang::Boolean");
+          static const String::Literal NAME("java::lang::Boolean");
+          return Class::forName(NAME);
     }
 
     //////////////////////////
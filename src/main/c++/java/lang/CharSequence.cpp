@@ -0,0 +1,56 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#include <algorithm>
+#include "java/lang/CharSequence.hpp"
+#include "java/lang/Character.hpp"
+
+int CharSequence::Interface::indexOf(Type::uchar ch, int fromIndex) const {
+    for (int i = (fromIndex < 0) ? 0 : fromIndex, n = length(); i < n; ++i) {
+        if (charAt(i) == ch)
+            return i;
+    }
+    return -1;
+}
+
+int CharSequence::Interface::lastIndexOf(Type::uchar ch, int fromIndex) const {
+    for (int i = std::min(fromIndex, length() - 1); i >= 0; --i) {
+        if (charAt(i) == ch)
+            return i;
+    }
+    return -1;
+}
+
+int CharSequence::Interface::indexOf(const CharSequence& str, int fromIndex) const {
+    int n = length();
+    int m = str.length();
+    for (int i = std::max(0, std::min(fromIndex, n)); i <= n - m; ++i) {
+        if (regionMatches(false, i, str, 0, m))
+            return i;
+    }
+    return -1;
+}
+
+int CharSequence::Interface::lastIndexOf(const CharSequence& str, int fromIndex) const {
+    for (int i = std::min(fromIndex, length() - str.length()); i >= 0; --i) {
+        if (regionMatches(false, i, str, 0, str.length()))
+            return i;
+    }
+    return -1;
+}
+
+bool CharSequence::Interface::regionMatches(bool ignoreCase, int offset, const CharSequence& other, int otherOffset,
+        int length) const {
+    if ((offset < 0) || (otherOffset < 0) || (offset > this->length() - length)
+            || (otherOffset > other.length() - length))
+        return false;
+    for (int i = 0; i < length; ++i) {
+        Type::uchar c1 = charAt(offset + i);
+        Type::uchar c2 = other.charAt(otherOffset + i);
+        if ((c1 != c2) && (!ignoreCase || !Character::equalsIgnoreCase(c1, c2)))
+            return false;
+    }
+    return true;
+}
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <limits>
 #include "java/lang/Object.hpp"
 
 namespace java {
@@ -37,6 +38,38 @@ public:
          */
         virtual CharSequence subSequence(int start, int end) const = 0;
 
+        /**
+         * Returns the index of the first occurrence of the specified character at or after the specified index
+         * (-1 if none). The default implementation iterates using charAt.
+         */
+        virtual int indexOf(Type::uchar ch, int fromIndex) const;
+
+        /**
+         * Returns the index of the last occurrence of the specified character at or before the specified index
+         * (-1 if none). The default implementation iterates using charAt.
+         */
+        virtual int lastIndexOf(Type::uchar ch, int fromIndex) const;
+
+        /**
+         * Returns the index of the first occurrence of the specified sequence at or after the specified index
+         * (-1 if none). The default implementation iterates using charAt.
+         */
+        virtual int indexOf(const CharSequence& str, int fromIndex) const;
+
+        /**
+         * Returns the index of the last occurrence of the specified sequence at or before the specified index
+         * (-1 if none). The default implementation iterates using charAt.
+         */
+        virtual int lastIndexOf(const CharSequence& str, int fromIndex) const;
+
+        /**
+         * Tests if the specified regions of this sequence and of the specified sequence are equal, ignoring case
+         * differences if requested (see Character::toUpperCase). Returns false if any region is out of range.
+         * The default implementation iterates using charAt.
+         */
+        virtual bool regionMatches(bool ignoreCase, int offset, const CharSequence& other, int otherOffset,
+                int length) const;
+
     };
 
     INTERFACE(CharSequence)
@@ -53,6 +86,37 @@ public:
         return this_cast_<Interface>()->subSequence(start, end);
     }
 
+    int indexOf(Type::uchar ch, int fromIndex = 0) const {
+        return this_cast_<Interface>()->indexOf(ch, fromIndex);
+    }
+
+    int lastIndexOf(Type::uchar ch, int fromIndex = std::numeric_limits<int>::max()) const {
+        return this_cast_<Interface>()->lastIndexOf(ch, fromIndex);
+    }
+
+    int indexOf(const CharSequence& str, int fromIndex = 0) const {
+        return this_cast_<Interface>()->indexOf(str, fromIndex);
+    }
+
+    int lastIndexOf(const CharSequence& str, int fromIndex = std::numeric_limits<int>::max()) const {
+        return this_cast_<Interface>()->lastIndexOf(str, fromIndex);
+    }
+
+    /**
+     * Indicates if this sequence contains the specified sequence.
+     */
+    bool contains(const CharSequence& str) const {
+        return indexOf(str, 0) >= 0;
+    }
+
+    bool regionMatches(int offset, const CharSequence& other, int otherOffset, int length) const {
+        return this_cast_<Interface>()->regionMatches(false, offset, other, otherOffset, length);
+    }
+
+    bool regionMatches(bool ignoreCase, int offset, const CharSequence& other, int otherOffset, int length) const {
+        return this_cast_<Interface>()->regionMatches(ignoreCase, offset, other, otherOffset, length);
+    }
+
 };
 
 }
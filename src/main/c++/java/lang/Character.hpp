@@ -77,6 +77,81 @@ public:
         return (char) value;
     }
 
+    /**
+     * Converts the specified character to uppercase. The mapping covers the Latin-1, Latin Extended-A, Greek and
+     * Cyrillic letters; other characters are returned unchanged.
+     */
+    static Type::uchar toUpperCase(Type::uchar ch) {
+        if (ch < 0x80)
+            return ((ch >= 'a') && (ch <= 'z')) ? ch - 32 : ch;
+        if (ch < 0x100) {
+            if (ch == 0xB5) // Micro sign.
+                return 0x39C;
+            if (ch == 0xFF)
+                return 0x178;
+            return ((ch >= 0xE0) && (ch != 0xF7)) ? ch - 32 : ch;
+        }
+        if (ch < 0x180) { // Latin Extended-A (pairs).
+            if (ch == 0x131) // Dotless i.
+                return 'I';
+            if (ch == 0x17F) // Long s.
+                return 'S';
+            if ((ch <= 0x137) || ((ch >= 0x14A) && (ch <= 0x177)))
+                return ch & ~1; // Lowercase is odd.
+            if (((ch >= 0x139) && (ch <= 0x148)) || ((ch >= 0x179) && (ch <= 0x17E)))
+                return ((ch & 1) == 0) ? ch - 1 : ch; // Lowercase is even.
+            return ch;
+        }
+        if ((ch >= 0x3B1) && (ch <= 0x3C9)) // Greek.
+            return (ch == 0x3C2) ? 0x3A3 : ch - 32; // Final sigma.
+        if ((ch >= 0x430) && (ch <= 0x44F)) // Cyrillic.
+            return ch - 32;
+        if ((ch >= 0x450) && (ch <= 0x45F))
+            return ch - 80;
+        return ch;
+    }
+
+    /**
+     * Converts the specified character to lowercase. The mapping covers the Latin-1, Latin Extended-A, Greek and
+     * Cyrillic letters; other characters are returned unchanged.
+     */
+    static Type::uchar toLowerCase(Type::uchar ch) {
+        if (ch < 0x80)
+            return ((ch >= 'A') && (ch <= 'Z')) ? ch + 32 : ch;
+        if (ch < 0x100)
+            return ((ch >= 0xC0) && (ch <= 0xDE) && (ch != 0xD7)) ? ch + 32 : ch;
+        if (ch < 0x180) { // Latin Extended-A (pairs).
+            if (ch == 0x130) // Capital I with dot above.
+                return 'i';
+            if (ch == 0x178)
+                return 0xFF;
+            if ((ch <= 0x137) || ((ch >= 0x14A) && (ch <= 0x177)))
+                return ch | 1; // Uppercase is even.
+            if (((ch >= 0x139) && (ch <= 0x148)) || ((ch >= 0x179) && (ch <= 0x17E)))
+                return ((ch & 1) != 0) ? ch + 1 : ch; // Uppercase is odd.
+            return ch;
+        }
+        if ((ch >= 0x391) && (ch <= 0x3A9) && (ch != 0x3A2)) // Greek.
+            return ch + 32;
+        if ((ch >= 0x410) && (ch <= 0x42F)) // Cyrillic.
+            return ch + 32;
+        if ((ch >= 0x400) && (ch <= 0x40F))
+            return ch + 80;
+        return ch;
+    }
+
+    /**
+     * Indicates if the specified characters are equal ignoring case; the characters are compared after conversion
+     * to uppercase then to lowercase (as String::regionMatches does).
+     */
+    static bool equalsIgnoreCase(Type::uchar c1, Type::uchar c2) {
+        if (c1 == c2)
+            return true;
+        Type::uchar u1 = toUpperCase(c1);
+        Type::uchar u2 = toUpperCase(c2);
+        return (u1 == u2) || (toLowerCase(u1) == toLowerCase(u2));
+    }
+
     /////////////////////////////////////////////////////////////
     // Object::Interface Equivalent methods (for template use) //
     /////////////////////////////////////////////////////////////
@@ -94,7 +169,8 @@ public:
     }
 
     Class getClass() const {
-          return Class::forName("java::lang::Character");
+          static const String::Literal NAME("java::lang::Character");
+          return Class::forName(NAME);
     }
 
     //////////////////////////
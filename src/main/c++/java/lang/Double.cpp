@@ -0,0 +1,192 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+
+#include <cstdlib>
+#include <string>
+#include "java/lang/Double.hpp"
+#include "java/lang/Float.hpp"
+#include "java/lang/IndexOutOfBoundsException.hpp"
+#include "java/lang/NumberFormatException.hpp"
+
+// Double::parseDouble and Float::parseFloat share the same parser.
+
+namespace {
+
+template<typename T> struct FloatingPoint;
+
+template<> struct FloatingPoint<double> {
+    static const int MAX_EXACT_POWER = 22; // 10^22 is the largest power of ten exactly representable.
+    static const unsigned long long MAX_EXACT_MANTISSA = 1ULL << 53; // 2^53
+    static double powerOfTen(int n) {
+        static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+                1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        return POWERS[n];
+    }
+    static double convert(const char* chars) {
+        return std::strtod(chars, nullptr);
+    }
+};
+
+template<> struct FloatingPoint<float> {
+    static const int MAX_EXACT_POWER = 10;
+    static const unsigned long long MAX_EXACT_MANTISSA = 1ULL << 24; // 2^24
+    static float powerOfTen(int n) {
+        static const float POWERS[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+        return POWERS[n];
+    }
+    static float convert(const char* chars) {
+        return std::strtof(chars, nullptr);
+    }
+};
+
+bool matches(const CharSequence::Interface* chars, int i, int end, const char* word) {
+    for (; *word != 0; ++i, ++word) {
+        if ((i >= end) || (chars->charAt(i) != *word))
+            return false;
+    }
+    return i == end;
+}
+
+bool isDigit(Type::uchar c) {
+    return (c >= '0') && (c <= '9');
+}
+
+bool isHexDigit(Type::uchar c) {
+    return isDigit(c) || ((c >= 'a') && (c <= 'f')) || ((c >= 'A') && (c <= 'F'));
+}
+
+bool isSuffix(Type::uchar c) {
+    return (c == 'f') || (c == 'F') || (c == 'd') || (c == 'D');
+}
+
+/** Converts the specified (validated) ASCII characters using the C library (correctly rounded). */
+template<typename T> T convert(const CharSequence::Interface* chars, int start, int end) {
+    static const int BUFFER_LENGTH = 128;
+    char buffer[BUFFER_LENGTH + 1];
+    std::string large;
+    char* ascii = buffer;
+    if (end - start > BUFFER_LENGTH) { // Very long number (rare).
+        large.resize(end - start);
+        ascii = &large[0];
+    }
+    for (int i = start; i < end; ++i)
+        ascii[i - start] = (char) chars->charAt(i);
+    ascii[end - start] = 0;
+    return FloatingPoint<T>::convert(ascii);
+}
+
+template<typename T> T parse(const CharSequence& csq, int beginIndex, int endIndex) {
+    if ((beginIndex < 0) || (beginIndex > endIndex) || (endIndex > csq.length()))
+        throw IndexOutOfBoundsException();
+    const CharSequence::Interface* chars = csq.this_cast_<CharSequence::Interface>();
+    int start = beginIndex;
+    int end = endIndex;
+    while ((start < end) && (chars->charAt(start) <= ' ')) // Java trims whitespaces.
+        ++start;
+    while ((end > start) && (chars->charAt(end - 1) <= ' '))
+        --end;
+    int i = start;
+    bool negative = false;
+    if ((i < end) && ((chars->charAt(i) == '-') || (chars->charAt(i) == '+')))
+        negative = (chars->charAt(i++) == '-');
+    if (matches(chars, i, end, "NaN"))
+        return std::numeric_limits<T>::quiet_NaN();
+    if (matches(chars, i, end, "Infinity"))
+        return negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+    if ((end - i > 2) && (chars->charAt(i) == '0') && ((chars->charAt(i + 1) == 'x') || (chars->charAt(i + 1) == 'X'))) {
+        int digits = 0; // Hexadecimal significand and mandatory binary exponent.
+        bool point = false;
+        for (i += 2; i < end; ++i) {
+            Type::uchar c = chars->charAt(i);
+            if (isHexDigit(c)) {
+                ++digits;
+            } else if ((c == '.') && !point) {
+                point = true;
+            } else
+                break;
+        }
+        if ((digits == 0) || (i == end) || ((chars->charAt(i) != 'p') && (chars->charAt(i) != 'P')))
+            throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+        if ((++i < end) && ((chars->charAt(i) == '-') || (chars->charAt(i) == '+')))
+            ++i;
+        int exponentStart = i;
+        while ((i < end) && isDigit(chars->charAt(i)))
+            ++i;
+        int numberEnd = i;
+        if ((i < end) && isSuffix(chars->charAt(i)))
+            ++i;
+        if ((exponentStart == numberEnd) || (i != end))
+            throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+        return convert<T>(chars, start, numberEnd);
+    }
+    unsigned long long mantissa = 0; // Up to 19 significant digits.
+    int significantDigits = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool point = false;
+    for (; i < end; ++i) {
+        Type::uchar c = chars->charAt(i);
+        if (isDigit(c)) {
+            ++digits;
+            if (point)
+                --exponent;
+            if ((mantissa == 0) && (c == '0')) // Leading zero.
+                continue;
+            if (significantDigits++ < 19)
+                mantissa = mantissa * 10 + (c - '0');
+        } else if ((c == '.') && !point) {
+            point = true;
+        } else
+            break;
+    }
+    if (digits == 0)
+        throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+    if ((i < end) && ((chars->charAt(i) == 'e') || (chars->charAt(i) == 'E'))) {
+        bool negativeExponent = false;
+        if ((++i < end) && ((chars->charAt(i) == '-') || (chars->charAt(i) == '+')))
+            negativeExponent = (chars->charAt(i++) == '-');
+        int exponentDigits = 0;
+        int value = 0;
+        for (; (i < end) && isDigit(chars->charAt(i)); ++i, ++exponentDigits) {
+            if (value < 100000) // Saturates (infinity or zero anyway).
+                value = value * 10 + (chars->charAt(i) - '0');
+        }
+        if (exponentDigits == 0)
+            throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+        exponent += negativeExponent ? -value : value;
+    }
+    int numberEnd = i;
+    if ((i < end) && isSuffix(chars->charAt(i)))
+        ++i;
+    if (i != end)
+        throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+    if (mantissa == 0)
+        return negative ? -T(0) : T(0);
+    // Exact fast path (Clinger), both the mantissa and the power of ten are exact. The mantissa is checked before
+    // its conversion, which would round it.
+    if ((significantDigits <= 19) && (mantissa <= FloatingPoint<T>::MAX_EXACT_MANTISSA)) {
+        const int MAX_POWER = FloatingPoint<T>::MAX_EXACT_POWER;
+        for (; (exponent > MAX_POWER) && (mantissa * 10 <= FloatingPoint<T>::MAX_EXACT_MANTISSA); --exponent)
+            mantissa *= 10; // e.g. 1e30 = 10^8 * 10^22 (exact).
+        if ((exponent >= -MAX_POWER) && (exponent <= MAX_POWER)) {
+            T value = (T) mantissa;
+            value = (exponent < 0) ? value / FloatingPoint<T>::powerOfTen(-exponent) :
+                    value * FloatingPoint<T>::powerOfTen(exponent);
+            return negative ? -value : value;
+        }
+    }
+    return convert<T>(chars, start, numberEnd);
+}
+
+} // namespace
+
+double Double::parseDouble(const CharSequence& csq, int beginIndex, int endIndex) {
+    return parse<double>(csq, beginIndex, endIndex);
+}
+
+float Float::parseFloat(const CharSequence& csq, int beginIndex, int endIndex) {
+    return parse<float>(csq, beginIndex, endIndex);
+}
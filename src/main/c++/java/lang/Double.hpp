@@ -53,6 +53,27 @@ public:
         return Double(value);
     }
 
+    /**
+     * Parses the specified character sequence as Java does (leading and trailing whitespaces are ignored;
+     * "NaN", "Infinity", decimal and hexadecimal notations with optional type suffix are supported).
+     * The result is correctly rounded; no allocation is performed for numbers of up to 128 characters.
+     *
+     * @throws NumberFormatException if the character sequence does not contain a parsable double.
+     */
+    static double parseDouble(const CharSequence& csq) {
+        return parseDouble(csq, 0, csq.length());
+    }
+
+    /**
+     * Parses the characters of the specified sequence from beginIndex (inclusive) to endIndex (exclusive)
+     * as a double (see parseDouble(csq)).
+     *
+     * @throws IndexOutOfBoundsException if beginIndex is negative, or if beginIndex is greater than endIndex
+     *         or if endIndex is greater than csq.length().
+     * @throws NumberFormatException if the characters do not contain a parsable double.
+     */
+    static double parseDouble(const CharSequence& csq, int beginIndex, int endIndex);
+
     /** Indicates if the specified number is a Not-a-Number (NaN) value. */
     static bool isNaN(double d) {
         return (d != d);
@@ -100,7 +121,8 @@ public:
     }
 
     Class getClass() const {
-          return Class::forName("java::lang::Double");
+          static const String::Literal NAME("java::lang::Double");
+          return Class::forName(NAME);
     }
 
     //////////////////////////////////////////////////
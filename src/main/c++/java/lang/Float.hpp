@@ -58,6 +58,26 @@ public:
         return Float(value);
     }
 
+    /**
+     * Parses the specified character sequence as Java does (see Double::parseDouble); the result is
+     * correctly rounded to the nearest float.
+     *
+     * @throws NumberFormatException if the character sequence does not contain a parsable float.
+     */
+    static float parseFloat(const CharSequence& csq) {
+        return parseFloat(csq, 0, csq.length());
+    }
+
+    /**
+     * Parses the characters of the specified sequence from beginIndex (inclusive) to endIndex (exclusive)
+     * as a float (see parseFloat(csq)).
+     *
+     * @throws IndexOutOfBoundsException if beginIndex is negative, or if beginIndex is greater than endIndex
+     *         or if endIndex is greater than csq.length().
+     * @throws NumberFormatException if the characters do not contain a parsable float.
+     */
+    static float parseFloat(const CharSequence& csq, int beginIndex, int endIndex);
+
     /** Indicates if the specified number is a Not-a-Number (NaN) value. */
     static bool isNaN(float f) {
         return (f != f);
@@ -103,7 +123,8 @@ public:
     }
 
     Class getClass() const {
-          return Class::forName("java::lang::Float");
+          static const String::Literal NAME("java::lang::Float");
+          return Class::forName(NAME);
     }
 
     //////////////////////////////////////////////////
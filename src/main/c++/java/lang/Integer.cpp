@@ -4,7 +4,17 @@
  * All rights reserved.
  */
 
+#include <limits>
 #include "java/lang/Integer.hpp"
+#include "java/lang/Long.hpp"
+#include "java/lang/NumberFormatException.hpp"
 
 const Integer Integer::MAX_VALUE = Integer(0x7FFFFFFF);
 const Integer Integer::MIN_VALUE = Integer(0x80000000);
+
+Type::int32 Integer::parseInt(const CharSequence& csq, int beginIndex, int endIndex, int radix) {
+    Type::int64 value = Long::parseLong(csq, beginIndex, endIndex, radix);
+    if ((value < std::numeric_limits<Type::int32>::min()) || (value > std::numeric_limits<Type::int32>::max()))
+        throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+    return (Type::int32) value;
+}
@@ -4,7 +4,49 @@
  * All rights reserved.
  */
 
+#include <limits>
 #include "java/lang/Long.hpp"
+#include "java/lang/IndexOutOfBoundsException.hpp"
+#include "java/lang/NumberFormatException.hpp"
 
 const Long Long::MAX_VALUE = Long(0x7FFFFFFFFFFFFFFFL);
 const Long Long::MIN_VALUE = Long(0x8000000000000000L);
+
+static int digitOf(Type::uchar c, int radix) { // Returns -1 if not a digit in the specified radix.
+    int digit = ((c >= '0') && (c <= '9')) ? c - '0' : ((c >= 'a') && (c <= 'z')) ? c - 'a' + 10 :
+                ((c >= 'A') && (c <= 'Z')) ? c - 'A' + 10 : -1;
+    return (digit < radix) ? digit : -1;
+}
+
+Type::int64 Long::parseLong(const CharSequence& csq, int beginIndex, int endIndex, int radix) {
+    if ((beginIndex < 0) || (beginIndex > endIndex) || (endIndex > csq.length()))
+        throw IndexOutOfBoundsException();
+    if ((radix < 2) || (radix > 36))
+        throw NumberFormatException("Radix out of range: " + String::valueOf(radix));
+    const CharSequence::Interface* chars = csq.this_cast_<CharSequence::Interface>();
+    int i = beginIndex;
+    bool negative = false;
+    if (i < endIndex) {
+        Type::uchar c = chars->charAt(i);
+        if ((c == '-') || (c == '+')) {
+            negative = (c == '-');
+            ++i;
+        }
+    }
+    if (i == endIndex) // No digit.
+        throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+    // Accumulates negatively (the magnitude of the minimum value is greater than the maximum value).
+    Type::int64 limit = negative ? std::numeric_limits<Type::int64>::min() : -std::numeric_limits<Type::int64>::max();
+    Type::int64 multiplyMin = limit / radix;
+    Type::int64 result = 0;
+    for (; i < endIndex; ++i) {
+        int digit = digitOf(chars->charAt(i), radix);
+        if ((digit < 0) || (result < multiplyMin))
+            throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+        result *= radix;
+        if (result < limit + digit)
+            throw NumberFormatException::forInputString(csq, beginIndex, endIndex);
+        result -= digit;
+    }
+    return negative ? result : -result;
+}
@@ -55,6 +55,25 @@ public:
         return Long(value);
     }
 
+    /**
+     * Parses the specified character sequence as a signed long in the specified radix (no allocation).
+     *
+     * @throws NumberFormatException if the character sequence does not contain a parsable long.
+     */
+    static Type::int64 parseLong(const CharSequence& csq, int radix = 10) {
+        return parseLong(csq, 0, csq.length(), radix);
+    }
+
+    /**
+     * Parses the characters of the specified sequence from beginIndex (inclusive) to endIndex (exclusive)
+     * as a signed long in the specified radix (no allocation).
+     *
+     * @throws IndexOutOfBoundsException if beginIndex is negative, or if beginIndex is greater than endIndex
+     *         or if endIndex is greater than csq.length().
+     * @throws NumberFormatException if the characters do not contain a parsable long.
+     */
+    static Type::int64 parseLong(const CharSequence& csq, int beginIndex, int endIndex, int radix);
+
     /**
      * Compares two {@code long} values numerically.
      */
@@ -86,7 +105,8 @@ public:
     }
 
     Class getClass() const {
-          return Class::forName("java::lang::Long");
+          static const String::Literal NAME("java::lang::Long");
+          return Class::forName(NAME);
     }
 
     //////////////////////////////////////////////////
@@ -0,0 +1,36 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include "java/lang/IllegalArgumentException.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Thrown to indicate that the application has attempted to convert a string to one of the numeric types,
+ * but that the string does not have the appropriate format.
+ *
+ * @see  <a href="https://docs.oracle.com/javase/8/docs/api/java/lang/NumberFormatException.html">
+ *       Java - NumberFormatException</a>
+ * @version 7.0
+ */
+class NumberFormatException: public IllegalArgumentException {
+public:
+
+    /** Creates a number format exception with the specified optional message.*/
+    NumberFormatException(const String message = nullptr) :
+            IllegalArgumentException(message) {
+    }
+
+    /** Creates a number format exception for the specified range of characters. */
+    static NumberFormatException forInputString(const CharSequence& csq, int beginIndex, int endIndex) {
+        return NumberFormatException("For input string: \"" + csq.subSequence(beginIndex, endIndex).toString() + "\"");
+    }
+};
+
+}
+}
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <iostream>
+#include <utility>
 #include "Javolution.hpp"
 #include "java/lang/Void.hpp"
 
@@ -33,23 +34,70 @@ public:
 class Object_Value {
     friend class Object;
 
+public:
+
+    /** The reference counting of a value (set at construction). */
+    enum RefCounting : Type::int8 {
+        SHARED, // Atomic (thread-safe handles).
+        CONFINED, // Non-atomic, for values never referenced concurrently by several threads.
+        IMMORTAL // None, for values never deleted (statically allocated or kept for the application lifetime).
+    };
+
+private:
+
     Type::atomic_count refCount;
+    const RefCounting counting;
 
     void incRefCount() {
-        ++refCount;
+        if (counting == SHARED) {
+            ++refCount;
+        } else if (counting == CONFINED) { // No locked instruction.
+            refCount.store(refCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
     }
 
     bool decRefCount() {
-        return --refCount == 0;
+        if (counting == SHARED)
+            return --refCount == 0;
+        if (counting == IMMORTAL)
+            return false;
+        int count = refCount.load(std::memory_order_relaxed) - 1;
+        refCount.store(count, std::memory_order_relaxed);
+        return count == 0;
     }
 
-public:
+protected:
 
-    /** Default constructor.*/
-    Object_Value() {
+    /**
+     * Constructor for values whose handles are not atomically reference counted: thread-confined values
+     * (copying or destroying their handles requires no locked instruction) or immortal values (never deleted).
+     */
+    explicit Object_Value(RefCounting counting) :
+            counting(counting) {
         std::atomic_init(&refCount, 0);
     }
 
+public:
+
+    /** Default constructor (atomic reference counting).*/
+    Object_Value() :
+            Object_Value(SHARED) {
+    }
+
+    /**
+     * Indicates if this value is immortal.
+     */
+    bool isImmortal_() const {
+        return counting == IMMORTAL;
+    }
+
+    /**
+     * Indicates if this value is thread-confined.
+     */
+    bool isConfined_() const {
+        return counting == CONFINED;
+    }
+
     /**
      * Indicates whether some other object value is "equal to" this one.
      */
@@ -134,6 +182,12 @@ public:
             valuePtr->incRefCount();
     }
 
+    /** Move constructor (the reference count is not updated, the specified object becomes null). */
+    Object(Object&& that) noexcept :
+            valuePtr(that.valuePtr) {
+        that.valuePtr = nullptr;
+    }
+
     /** Cast this object value to the specified type; returns nullptr if the cast is invalid. */
     template<class T> T* cast_() const {
         return dynamic_cast<T*>(valuePtr);
@@ -191,6 +245,11 @@ public:
         return *this;
     }
 
+    Object& operator=(Object&& that) noexcept {
+        Object(std::move(that)).swap(*this);
+        return *this;
+    }
+
     Object& operator=(Value* that) {
         Object(that).swap(*this);
         return *this;
@@ -4,17 +4,507 @@
  * All rights reserved.
  */
 
-#include <locale>
-#include <codecvt>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "java/lang/String.hpp"
 #include "java/lang/StringBuilder.hpp"
+#include "java/lang/Character.hpp"
+#include "java/lang/IllegalArgumentException.hpp"
 #include "java/lang/IndexOutOfBoundsException.hpp"
 #include "java/lang/UnsupportedOperationException.hpp"
 #include "java/lang/System.hpp"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <immintrin.h>
+#define JAVOLUTION_SSE2 // The AVX2 variants are selected at run-time.
+#define JAVOLUTION_AVX2
+#elif defined(JAVOLUTION_MSVC) && defined(_M_X64)
+#include <emmintrin.h>
+#include <intrin.h>
+#define JAVOLUTION_SSE2
+#endif
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Transcoding kernels, they convert the leading characters of their input up to MAX (ASCII  //
+// or Latin-1) and return the number of characters converted (0 if the first block cannot). //
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+template<int MAX> int narrowScalar(const Type::uchar* in, int n, char* out) {
+    const std::uint64_t mask = (std::uint64_t) (0xFFFF & ~MAX) * 0x0001000100010001ULL;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        std::uint64_t word;
+        std::memcpy(&word, in + i, sizeof(word));
+        if (word & mask)
+            break;
+        out[i] = (char) in[i];
+        out[i + 1] = (char) in[i + 1];
+        out[i + 2] = (char) in[i + 2];
+        out[i + 3] = (char) in[i + 3];
+    }
+    return i;
+}
+
+int widenScalar(const char* in, int n, Type::uchar* out) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, in + i, sizeof(word));
+        if (word & 0x8080808080808080ULL)
+            break;
+        for (int j = 0; j < 8; ++j)
+            out[i + j] = (Type::uchar) in[i + j];
+    }
+    return i;
+}
+
+#ifdef JAVOLUTION_SSE2
+
+template<int MAX> int narrowSSE2(const Type::uchar* in, int n, char* out) {
+    const __m128i mask = _mm_set1_epi16((short) ~MAX);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+        __m128i high = _mm_and_si128(_mm_or_si128(a, b), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(a, b));
+    }
+    return i + narrowScalar<MAX>(in + i, n - i, out + i);
+}
+
+int widenSSE2(const char* in, int n, Type::uchar* out) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    return i + widenScalar(in + i, n - i, out + i);
+}
+
+#endif
+
+#ifdef JAVOLUTION_AVX2
+
+template<int MAX> __attribute__((target("avx2"))) int narrowAVX2(const Type::uchar* in, int n, char* out) {
+    const __m256i mask = _mm256_set1_epi16((short) ~MAX);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 16));
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), mask))
+            break;
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8); // Packs per 128-bits lane.
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    _mm256_zeroupper(); // Avoids the AVX to SSE transition penalty.
+    return i + narrowSSE2<MAX>(in + i, n - i, out + i);
+}
+
+__attribute__((target("avx2"))) int widenAVX2(const char* in, int n, Type::uchar* out) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        if (_mm256_movemask_epi8(v) != 0)
+            break;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16),
+                _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+    }
+    _mm256_zeroupper();
+    return i + widenSSE2(in + i, n - i, out + i);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Search kernels, they return the index of the first occurrence of a character (or -1). //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int findScalar(const Type::uchar* in, int n, Type::uchar c) {
+    for (int i = 0; i < n; ++i) {
+        if (in[i] == c)
+            return i;
+    }
+    return -1;
+}
+
+#ifdef JAVOLUTION_SSE2
+
+/** Returns the index of the lowest bit set of the specified mask (not zero). */
+inline int lowestBit(unsigned int mask) {
+#ifdef JAVOLUTION_MSVC
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int) index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+int findSSE2(const Type::uchar* in, int n, Type::uchar c) {
+    const __m128i needle = _mm_set1_epi16((short) c);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi16(v, needle));
+        if (mask != 0)
+            return i + (lowestBit(mask) >> 1);
+    }
+    int j = findScalar(in + i, n - i, c);
+    return (j < 0) ? -1 : i + j;
+}
+
+#endif
+
+#ifdef JAVOLUTION_AVX2
+
+__attribute__((target("avx2"))) int findAVX2(const Type::uchar* in, int n, Type::uchar c) {
+    const __m256i needle = _mm256_set1_epi16((short) c);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi16(v, needle));
+        if (mask != 0)
+            return i + (lowestBit(mask) >> 1);
+    }
+    _mm256_zeroupper();
+    int j = findSSE2(in + i, n - i, c);
+    return (j < 0) ? -1 : i + j;
+}
+
+#endif
+
+/** Returns the index of the first different element in the specified regions (or n), compared segment by
+ *  segment using memcmp. */
+template<typename E> int mismatchSegments(const Array<E>& a, int aPos, const Array<E>& b, int bPos, int n) {
+    const typename Array<E>::Value* aValue = a.template this_<typename Array<E>::Value>();
+    const typename Array<E>::Value* bValue = b.template this_<typename Array<E>::Value>();
+    for (int i = 0; i < n;) {
+        int aCount, bCount;
+        const E* aSegment = aValue->segmentAt(aPos + i, aCount);
+        const E* bSegment = bValue->segmentAt(bPos + i, bCount);
+        int count = std::min(std::min(aCount, bCount), n - i);
+        if (std::memcmp(aSegment, bSegment, count * sizeof(E)) != 0) {
+            int j = 0;
+            while (aSegment[j] == bSegment[j])
+                ++j;
+            return i + j;
+        }
+        i += count;
+    }
+    return n;
+}
+
+/** Returns the hash code contribution of the specified segment (four characters at a time). */
+template<typename E> unsigned int hashSegment(unsigned int h, const E* segment, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        h = 923521u * h + 29791u * segment[i] + 961u * segment[i + 1] + 31u * segment[i + 2] + segment[i + 3];
+    for (; i < n; ++i)
+        h = 31u * h + segment[i];
+    return h;
+}
+
+/** The minimal lengths of balanced ropes by depth (Fibonacci numbers, <code>F(depth + 2)</code>). */
+struct RopeLengths {
+    Type::int64 values[64];
+
+    RopeLengths() {
+        values[0] = 1;
+        values[1] = 2;
+        for (int i = 2; i < 64; ++i)
+            values[i] = values[i - 1] + values[i - 2];
+    }
+};
+
+/** Returns the minimal length of a balanced rope of the specified depth. */
+Type::int64 minRopeLength(int depth) {
+    static const RopeLengths lengths;
+    return lengths.values[depth];
+}
+
+/** Returns the lock used to flatten the specified rope (striped locks). */
+std::mutex& flattenLock(const void* value) {
+    static std::mutex locks[64];
+    return locks[(reinterpret_cast<std::uintptr_t>(value) >> 6) & 63];
+}
+
+/** The table of interned strings (striped locks, indexed by hash code). */
+struct InternTable {
+    static const int STRIPES = 64;
+
+    struct Stripe {
+        std::mutex lock;
+        std::unordered_multimap<int, String> strings;
+    } stripes[STRIPES];
+
+    static Stripe& stripeOf(int hash) {
+        static InternTable* table = new InternTable(); // Never deleted (interned strings are immortal).
+        return table->stripes[(hash ^ (hash >> 16)) & (STRIPES - 1)];
+    }
+};
+
+/** The transcoding and search kernels selected for the current processor. */
+struct Kernels {
+    int (*narrow)(const Type::uchar* in, int n, char* out); // ASCII.
+    int (*widen)(const char* in, int n, Type::uchar* out); // ASCII.
+    int (*compact)(const Type::uchar* in, int n, char* out); // Latin-1.
+    int (*find)(const Type::uchar* in, int n, Type::uchar c);
+
+    static const Kernels& instance() {
+        static const Kernels kernels = select();
+        return kernels;
+    }
+
+private:
+    static Kernels select() {
+#if defined(JAVOLUTION_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Kernels { narrowAVX2<0x7F>, widenAVX2, narrowAVX2<0xFF>, findAVX2 };
+#endif
+#if defined(JAVOLUTION_SSE2)
+        return Kernels { narrowSSE2<0x7F>, widenSSE2, narrowSSE2<0xFF>, findSSE2 };
+#else
+        return Kernels { narrowScalar<0x7F>, widenScalar, narrowScalar<0xFF>, findScalar };
+#endif
+    }
+};
+
+/** Returns the index of the first occurrence of the specified character in the specified range (or -1). */
+int findChar(const Array<unsigned char>& array, int begin, int end, Type::uchar c) {
+    const Array<unsigned char>::Value* value = array.this_<Array<unsigned char>::Value>();
+    for (int i = begin; i < end;) {
+        int count;
+        const unsigned char* segment = value->segmentAt(i, count);
+        count = std::min(count, end - i);
+        const void* found = std::memchr(segment, c, count);
+        if (found != nullptr)
+            return i + (int) (static_cast<const unsigned char*>(found) - segment);
+        i += count;
+    }
+    return -1;
+}
+
+/** Returns the index of the first occurrence of the specified character in the specified range (or -1). */
+int findChar(const Array<Type::uchar>& array, int begin, int end, Type::uchar c) {
+    const Array<Type::uchar>::Value* value = array.this_<Array<Type::uchar>::Value>();
+    const Kernels& kernels = Kernels::instance();
+    for (int i = begin; i < end;) {
+        int count;
+        const Type::uchar* segment = value->segmentAt(i, count);
+        count = std::min(count, end - i);
+        int j = kernels.find(segment, count, c);
+        if (j >= 0)
+            return i + j;
+        i += count;
+    }
+    return -1;
+}
+
+/** Random access to the elements of an array range, the segment holding the last element read is cached. */
+template<typename E> class SegmentCursor {
+    const typename Array<E>::Value* array;
+    const int offset; // Array index of the first element of the range.
+    const E* segment; // The segment cached (starting at array index 'begin').
+    int begin;
+    int end;
+public:
+    SegmentCursor(const Array<E>& array, int offset) :
+            array(array.template this_<typename Array<E>::Value>()), offset(offset), segment(nullptr), begin(0),
+            end(0) {
+    }
+
+    E operator[](int index) {
+        index += offset;
+        if ((index < begin) || (index >= end))
+            fetch(index);
+        return segment[index - begin];
+    }
+
+private:
+    void fetch(int index) {
+        int count;
+        begin = index & ~(Array<E>::SEGMENT_SIZE - 1);
+        segment = array->segmentAt(begin, count);
+        end = begin + count;
+    }
+};
+
+/** Returns the index of the last occurrence of the specified character at or before the specified index. */
+template<typename E> int findLastChar(SegmentCursor<E>& text, int last, Type::uchar c) {
+    for (int i = last; i >= 0; --i) {
+        if (text[i] == c)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * Returns the start of the right half of the critical factorization of the specified needle and sets its period
+ * (the maximal suffix for either the natural or the reverse order, Crochemore-Perrin).
+ */
+int criticalFactorization(const Type::uchar* needle, int m, int& period) {
+    int maxSuffix = -1; // Natural order.
+    int j = 0, k = 1, p = 1;
+    while (j + k < m) {
+        Type::uchar a = needle[j + k];
+        Type::uchar b = needle[maxSuffix + k];
+        if (a < b) { // Suffix is smaller, the period is the entire prefix so far.
+            j += k;
+            k = 1;
+            p = j - maxSuffix;
+        } else if (a == b) { // Advances through the repetition of the current period.
+            if (k != p) {
+                ++k;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else { // Suffix is larger, starts over from the current location.
+            maxSuffix = j++;
+            k = p = 1;
+        }
+    }
+    period = p;
+    int maxSuffixReverse = -1; // Reverse order.
+    j = 0;
+    k = p = 1;
+    while (j + k < m) {
+        Type::uchar a = needle[j + k];
+        Type::uchar b = needle[maxSuffixReverse + k];
+        if (b < a) {
+            j += k;
+            k = 1;
+            p = j - maxSuffixReverse;
+        } else if (a == b) {
+            if (k != p) {
+                ++k;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            maxSuffixReverse = j++;
+            k = p = 1;
+        }
+    }
+    if (maxSuffixReverse < maxSuffix) // Chooses the longer suffix.
+        return maxSuffix + 1;
+    period = p;
+    return maxSuffixReverse + 1;
+}
+
+/**
+ * Returns the index of the first occurrence of the specified needle (at least two characters) in the text at or
+ * after the specified index (or -1). This is the Two-Way algorithm (linear time, constant space) with a bad
+ * character shift on the last character of each window, as in glibc. The shift table is indexed by the low byte of
+ * the characters; characters sharing a low byte have the smallest shift, which is still safe.
+ */
+template<typename E> int twoWaySearch(SegmentCursor<E>& text, int from, int n, const Type::uchar* needle, int m) {
+    int period;
+    int suffix = criticalFactorization(needle, m, period);
+    int shifts[256];
+    for (int i = 0; i < 256; ++i)
+        shifts[i] = m;
+    for (int i = 0; i < m; ++i)
+        shifts[needle[i] & 0xFF] = m - 1 - i;
+    int j = from;
+    if (std::memcmp(needle, needle + period, suffix * sizeof(Type::uchar)) == 0) { // Periodic needle.
+        int memory = 0; // Number of characters known to match at the start of the window.
+        while (j <= n - m) {
+            int shift = shifts[text[j + m - 1] & 0xFF];
+            if (shift > 0) {
+                if ((memory != 0) && (shift < period)) // The last period has a character out of place.
+                    shift = m - period;
+                memory = 0;
+                j += shift;
+                continue;
+            }
+            int i = std::max(suffix, memory); // Right half (the last character matches only by its low byte).
+            while ((i < m) && (needle[i] == text[i + j]))
+                ++i;
+            if (i < m) {
+                j += i - suffix + 1;
+                memory = 0;
+                continue;
+            }
+            i = suffix - 1; // Left half.
+            while ((i >= memory) && (needle[i] == text[i + j]))
+                --i;
+            if (i < memory)
+                return j;
+            j += period;
+            memory = m - period;
+        }
+    } else { // Non-periodic needle, the period is a lower bound.
+        period = std::max(suffix, m - suffix) + 1;
+        while (j <= n - m) {
+            int shift = shifts[text[j + m - 1] & 0xFF];
+            if (shift > 0) {
+                j += shift;
+                continue;
+            }
+            int i = suffix;
+            while ((i < m) && (needle[i] == text[i + j]))
+                ++i;
+            if (i < m) {
+                j += i - suffix + 1;
+                continue;
+            }
+            i = suffix - 1;
+            while ((i >= 0) && (needle[i] == text[i + j]))
+                --i;
+            if (i < 0)
+                return j;
+            j += period;
+        }
+    }
+    return -1;
+}
+
+}
+
 String String::valueOf(const char* value) {
-    StringBuilder sb = new StringBuilder::Value();
-    return sb.append(value).toString();
+    int length = (int) std::strlen(value);
+    Array<unsigned char> latin1 = Array<unsigned char>::newInstance(length);
+    latin1.forEachSegment(0, length, [&value](unsigned char* segment, int n) {
+        for (int i = 0; i < n; ++i) {
+            unsigned char c = (unsigned char) *value++;
+            if (c > 0x7f)
+                throw IllegalArgumentException("Illegal non-ASCII character");
+            segment[i] = c;
+        }
+    });
+    return new Value(latin1);
+}
+
+String::Literal::Literal(const char* chars) {
+    int length = (int) std::strlen(chars);
+    Array<unsigned char> latin1 = Array<unsigned char>::newInstance(length); // Owned copy (never released).
+    latin1.forEachSegment(0, length, [&chars](unsigned char* segment, int n) {
+        for (int i = 0; i < n; ++i) {
+            unsigned char c = (unsigned char) *chars++;
+            if (c > 0x7f)
+                throw IllegalArgumentException("Illegal non-ASCII character");
+            segment[i] = c;
+        }
+    });
+    ::new (&value) Value(latin1, Object::Value::IMMORTAL);
 }
 
 String String::valueOf(const Type::uchar* value) {
@@ -67,43 +557,302 @@ String String::valueOf(bool value) {
     return sb.append(value).toString();
 }
 
+String::Value::Value(const String& left, const String& right) :
+        offset(0), count(left.length() + right.length()),
+        compact(left.this_<Value>()->compact && right.this_<Value>()->compact),
+        depth(std::max(left.this_<Value>()->ropeDepth(), right.this_<Value>()->ropeDepth()) + 1), left(left), right(right),
+        flat(false), hash(0) {
+}
+
+void String::Value::flatten() const {
+    std::vector<Object> pending; // Strings to gather, the last one first.
+    {
+        std::lock_guard<std::mutex> guard(flattenLock(this));
+        if (flat.load(std::memory_order_relaxed))
+            return;
+        pending.push_back(right);
+        pending.push_back(left);
+    }
+    Array<unsigned char> latin1Array = compact ? Array<unsigned char>::newInstance(count) : nullptr;
+    Array<Type::uchar> ucharsArray = compact ? nullptr : Array<Type::uchar>::newInstance(count);
+    int pos = 0;
+    while (!pending.empty()) {
+        Object str = pending.back();
+        pending.pop_back();
+        const Value* value = str.this_<Value>();
+        if (!value->flat.load(std::memory_order_acquire)) { // No lock is held while acquiring another.
+            Object strLeft, strRight;
+            {
+                std::lock_guard<std::mutex> guard(flattenLock(value));
+                if (!value->flat.load(std::memory_order_relaxed)) {
+                    strLeft = value->left;
+                    strRight = value->right;
+                }
+            }
+            if (strLeft != nullptr) {
+                pending.push_back(strRight);
+                pending.push_back(strLeft);
+                continue;
+            }
+        }
+        if (compact) {
+            System::arraycopy(value->latin1, value->offset, latin1Array, pos, value->count);
+        } else if (!value->compact) {
+            System::arraycopy(value->uchars, value->offset, ucharsArray, pos, value->count);
+        } else {
+            int index = 0;
+            ucharsArray.forEachSegment(pos, pos + value->count, [&](Type::uchar* segment, int n) {
+                value->getChars(index, index + n, segment);
+                index += n;
+            });
+        }
+        pos += value->count;
+    }
+    Object oldLeft, oldRight; // Released once the lock is released.
+    std::lock_guard<std::mutex> guard(flattenLock(this));
+    if (flat.load(std::memory_order_relaxed))
+        return; // Flattened concurrently.
+    latin1 = latin1Array;
+    uchars = ucharsArray;
+    oldLeft = std::move(left);
+    oldRight = std::move(right);
+    flat.store(true, std::memory_order_release);
+}
+
+bool String::Value::children(String& leftString, String& rightString) const {
+    std::lock_guard<std::mutex> guard(flattenLock(this));
+    if (flat.load(std::memory_order_relaxed))
+        return false;
+    leftString = left.this_<Value>();
+    rightString = right.this_<Value>();
+    return true;
+}
+
+String String::Value::mergeRight(const String& str, const String& that) {
+    String x, y, z;
+    if (!str.this_<Value>()->children(x, y) || y.this_<Value>()->children(z, z)) // Right part not flat.
+        return nullptr;
+    return (y.length() + that.length() < MIN_ROPE_LENGTH) ? String(new Value(x, y.concat(that))) : nullptr;
+}
+
+bool String::Value::isBalanced(const String& str, int slack) {
+    const Value* value = str.this_<Value>();
+    int ropeDepth = value->ropeDepth();
+    return (ropeDepth < MAX_ROPE_DEPTH) && (value->count >= minRopeLength(std::max(ropeDepth - slack, 0)));
+}
+
+String String::Value::cat(const String& leftString, const String& rightString) {
+    if (leftString == nullptr)
+        return rightString;
+    if (rightString == nullptr)
+        return leftString;
+    return new Value(leftString, rightString);
+}
+
+String String::Value::balance(const String& rope) {
+    String forest[MAX_ROPE_DEPTH];
+    insertBalanced(rope, forest);
+    String sum;
+    for (int i = 0; i < MAX_ROPE_DEPTH; ++i) { // From the last (shortest) entry.
+        if (forest[i] != nullptr)
+            sum = cat(forest[i], sum);
+    }
+    return sum;
+}
+
+void String::Value::insertBalanced(const String& str, String* forest) {
+    String x, y;
+    if (isBalanced(str) || !str.this_<Value>()->children(x, y)) {
+        addToForest(str, forest);
+        return;
+    }
+    insertBalanced(x, forest);
+    insertBalanced(y, forest);
+}
+
+void String::Value::addToForest(const String& str, String* forest) {
+    int i = 0;
+    String sum;
+    for (; str.length() > minRopeLength(i + 1); ++i) { // Concatenates the shorter entries first.
+        if (forest[i] != nullptr) {
+            sum = cat(forest[i], sum);
+            forest[i] = nullptr;
+        }
+    }
+    sum = cat(sum, str);
+    for (; sum.length() >= minRopeLength(i); ++i) {
+        if (forest[i] != nullptr) {
+            sum = cat(forest[i], sum);
+            forest[i] = nullptr;
+        }
+    }
+    forest[i - 1] = sum;
+}
+
+String String::Value::valueOf(const Array<Type::uchar>& uchars, int begin, int end) {
+    if (isView(end - begin, uchars.length) && !isLatin1(uchars, begin, end))
+        return new Value(uchars, begin, end - begin);
+    Array<unsigned char> latin1 = compress(uchars, begin, end);
+    if (latin1 != nullptr)
+        return new Value(latin1);
+    Array<Type::uchar> tmp = Array<Type::uchar>::newInstance(end - begin);
+    System::arraycopy(uchars, begin, tmp, 0, end - begin);
+    return new Value(tmp);
+}
+
+bool String::Value::isLatin1(const Array<Type::uchar>& uchars, int begin, int end) {
+    const Array<Type::uchar>::Value* src = uchars.this_<Array<Type::uchar>::Value>();
+    while (begin < end) {
+        int count;
+        const Type::uchar* chars = src->segmentAt(begin, count);
+        count = std::min(count, end - begin);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            std::uint64_t word;
+            std::memcpy(&word, chars + i, sizeof(word));
+            if (word & 0xFF00FF00FF00FF00ULL)
+                return false;
+        }
+        for (; i < count; ++i) {
+            if (chars[i] > 0xFF)
+                return false;
+        }
+        begin += count;
+    }
+    return true;
+}
+
+Array<unsigned char> String::Value::compress(const Array<Type::uchar>& uchars, int begin, int end) {
+    const Kernels& kernels = Kernels::instance();
+    const Array<Type::uchar>::Value* src = uchars.this_<Array<Type::uchar>::Value>();
+    Array<unsigned char> latin1 = Array<unsigned char>::newInstance(end - begin);
+    bool compact = true;
+    latin1.forEachSegment(0, end - begin, [&](unsigned char* segment, int n) {
+        while (compact && (n > 0)) {
+            int count;
+            const Type::uchar* chars = src->segmentAt(begin, count);
+            count = std::min(count, n);
+            int i = kernels.compact(chars, count, reinterpret_cast<char*>(segment));
+            for (; i < count; ++i) {
+                if (chars[i] > 0xFF) {
+                    compact = false;
+                    return;
+                }
+                segment[i] = (unsigned char) chars[i];
+            }
+            begin += count;
+            segment += count;
+            n -= count;
+        }
+    });
+    return compact ? latin1 : Array<unsigned char>();
+}
+
+void String::Value::getChars(int begin, int end, Type::uchar* dst) const {
+    ensureFlat();
+    if (compact) {
+        latin1.forEachSegment(offset + begin, offset + end, [&dst](const unsigned char* segment, int n) {
+            for (int i = 0; i < n; ++i)
+                dst[i] = segment[i];
+            dst += n;
+        });
+    } else {
+        uchars.forEachSegment(offset + begin, offset + end, [&dst](const Type::uchar* segment, int n) {
+            std::memcpy(dst, segment, n * sizeof(Type::uchar));
+            dst += n;
+        });
+    }
+}
+
+int String::Value::mismatch(int offset, const Value& that, int thatOffset, int length) const {
+    ensureFlat();
+    that.ensureFlat();
+    if (compact && that.compact)
+        return mismatchSegments(latin1, this->offset + offset, that.latin1, that.offset + thatOffset, length);
+    if (!compact && !that.compact)
+        return mismatchSegments(uchars, this->offset + offset, that.uchars, that.offset + thatOffset, length);
+    static const int BUFFER_LENGTH = 128; // Different coders, compares UTF-16 characters.
+    Type::uchar thisBuffer[BUFFER_LENGTH];
+    Type::uchar thatBuffer[BUFFER_LENGTH];
+    for (int i = 0; i < length; i += BUFFER_LENGTH) {
+        int n = std::min(BUFFER_LENGTH, length - i);
+        getChars(offset + i, offset + i + n, thisBuffer);
+        that.getChars(thatOffset + i, thatOffset + i + n, thatBuffer);
+        for (int j = 0; j < n; ++j) {
+            if (thisBuffer[j] != thatBuffer[j])
+                return i + j;
+        }
+    }
+    return length;
+}
+
 String String::Value::substring(int beginIndex, int endIndex) const {
-    if ((beginIndex < 0) || (endIndex > length()) || (beginIndex > endIndex))
+    if ((beginIndex < 0) || (endIndex > count) || (beginIndex > endIndex))
         throw IndexOutOfBoundsException();
+    if ((beginIndex == 0) && (endIndex == count))
+        return toString();
+    ensureFlat();
+    if (!compact)
+        return valueOf(uchars, offset + beginIndex, offset + endIndex);
     int length = endIndex - beginIndex;
-    Array<Type::uchar> tmp = Array<Type::uchar>::newInstance(length);
-    System::arraycopy(uchars, beginIndex, tmp, 0, length);
-    return String(new Value(tmp));
+    if (isView(length, latin1.length))
+        return new Value(latin1, offset + beginIndex, length);
+    Array<unsigned char> tmp = Array<unsigned char>::newInstance(length);
+    System::arraycopy(latin1, offset + beginIndex, tmp, 0, length);
+    return new Value(tmp);
 }
 
 String String::Value::concat(const String& that) const {
-    Array<Type::uchar> tmp = uchars.clone();
-    tmp.setLength(length() + that.length());
-    System::arraycopy(that.this_<Value>()->uchars, 0, tmp, length(), that.length());
-    return String(new Value(tmp));
+    const Value* other = that.this_<Value>();
+    if (other->count == 0)
+        return toString();
+    if (count == 0)
+        return that;
+    int length = count + other->count;
+    if (length >= MIN_ROPE_LENGTH) {
+        if ((other->count < MIN_ROPE_LENGTH) && !flat.load(std::memory_order_acquire)) {
+            String merged = mergeRight(toString(), that); // Short strings appended are merged with the right part.
+            if (merged != nullptr)
+                return merged;
+        }
+        String rope = new Value(toString(), that);
+        return isBalanced(rope, ROPE_DEPTH_SLACK) ? rope : balance(rope);
+    }
+    if (compact && other->compact) {
+        ensureFlat();
+        other->ensureFlat();
+        Array<unsigned char> tmp = Array<unsigned char>::newInstance(length);
+        System::arraycopy(latin1, offset, tmp, 0, count);
+        System::arraycopy(other->latin1, other->offset, tmp, count, other->count);
+        return new Value(tmp);
+    }
+    Array<Type::uchar> tmp = Array<Type::uchar>::newInstance(length);
+    int pos = 0;
+    tmp.forEachSegment(0, count, [&](Type::uchar* segment, int n) {
+        getChars(pos, pos + n, segment);
+        pos += n;
+    });
+    pos = 0;
+    tmp.forEachSegment(count, length, [&](Type::uchar* segment, int n) {
+        other->getChars(pos, pos + n, segment);
+        pos += n;
+    });
+    return new Value(tmp); // At least one non Latin-1 character.
 }
 
 bool String::Value::startsWith(const String& prefix, int offset) const {
     int prefixLength = prefix.length();
-    if (prefixLength + offset > length())
+    if ((offset < 0) || (prefixLength + offset > count))
         return false;
-    for (int i = 0; i < prefixLength; i++) {
-        if (charAt(i + offset) != prefix.charAt(i))
-            return false;
-    }
-    return true;
+    return mismatch(offset, *prefix.this_<Value>(), 0, prefixLength) == prefixLength;
 }
 
 bool String::Value::endsWith(const String& suffix) const {
     int suffixLength = suffix.length();
-    int offset = length() - suffixLength;
+    int offset = count - suffixLength;
     if (offset < 0)
         return false;
-    for (int i = 0; i < suffixLength; i++) {
-        if (charAt(i + offset) != suffix.charAt(i))
-            return false;
-    }
-    return true;
+    return mismatch(offset, *suffix.this_<Value>(), 0, suffixLength) == suffixLength;
 }
 
 bool String::Value::equals(const Object& other) const {
@@ -115,39 +864,307 @@ bool String::Value::equals(const Object& other) const {
 bool String::Value::equals(const String& that) const {
     if (that == nullptr)
         return false;
-    if (length() != that.length())
+    const Value* other = that.this_<Value>();
+    if (this == other)
+        return true;
+    if (compact != other->compact) // Strings are compact whenever possible.
+        return false;
+    if (count != other->count)
+        return false;
+    int thisHash = hash.load(std::memory_order_relaxed);
+    int thatHash = other->hash.load(std::memory_order_relaxed);
+    if ((thisHash != 0) && (thatHash != 0) && (thisHash != thatHash))
+        return false;
+    return mismatch(0, *other, 0, count) == count;
+}
+
+int String::Value::compareTo(const String& that) const {
+    const Value* other = that.this_<Value>();
+    int n = std::min(count, other->count);
+    int i = mismatch(0, *other, 0, n);
+    return (i < n) ? charAt(i) - other->charAt(i) : count - other->count;
+}
+
+int String::Value::indexOf(Type::uchar ch, int fromIndex) const {
+    int begin = std::max(fromIndex, 0);
+    if ((begin >= count) || (compact && (ch > 0xFF)))
+        return -1;
+    ensureFlat();
+    int i = compact ? findChar(latin1, offset + begin, offset + count, ch)
+            : findChar(uchars, offset + begin, offset + count, ch);
+    return (i < 0) ? -1 : i - offset;
+}
+
+int String::Value::lastIndexOf(Type::uchar ch, int fromIndex) const {
+    int last = std::min(fromIndex, count - 1);
+    if ((last < 0) || (compact && (ch > 0xFF)))
+        return -1;
+    ensureFlat();
+    if (compact) {
+        SegmentCursor<unsigned char> text(latin1, offset);
+        return findLastChar(text, last, ch);
+    }
+    SegmentCursor<Type::uchar> text(uchars, offset);
+    return findLastChar(text, last, ch);
+}
+
+int String::Value::indexOf(const CharSequence& str, int fromIndex) const {
+    const Value* that = str.cast_<Value>();
+    if (that == nullptr)
+        return CharSequence::Interface::indexOf(str, fromIndex);
+    int m = that->count;
+    int begin = std::max(0, std::min(fromIndex, count));
+    if (m == 0)
+        return begin;
+    if ((m > count - begin) || (compact && !that->compact)) // Compact strings cannot hold non Latin-1 characters.
+        return -1;
+    if (m == 1)
+        return indexOf(that->charAt(0), begin);
+    static const int BUFFER_LENGTH = 128;
+    Type::uchar buffer[BUFFER_LENGTH];
+    std::vector<Type::uchar> largeBuffer;
+    Type::uchar* needle = buffer;
+    if (m > BUFFER_LENGTH) {
+        largeBuffer.resize(m);
+        needle = largeBuffer.data();
+    }
+    that->getChars(0, m, needle);
+    ensureFlat();
+    if (compact) {
+        SegmentCursor<unsigned char> text(latin1, offset);
+        return twoWaySearch(text, begin, count, needle, m);
+    }
+    SegmentCursor<Type::uchar> text(uchars, offset);
+    return twoWaySearch(text, begin, count, needle, m);
+}
+
+int String::Value::lastIndexOf(const CharSequence& str, int fromIndex) const {
+    const Value* that = str.cast_<Value>();
+    if (that == nullptr)
+        return CharSequence::Interface::lastIndexOf(str, fromIndex);
+    int m = that->count;
+    int last = std::min(fromIndex, count - m);
+    if ((last < 0) || (compact && !that->compact))
+        return -1;
+    if (m == 0)
+        return last;
+    Type::uchar first = that->charAt(0); // Candidates are located backward using the first character.
+    for (int i = lastIndexOf(first, last); i >= 0; i = lastIndexOf(first, i - 1)) {
+        if (mismatch(i + 1, *that, 1, m - 1) == m - 1)
+            return i;
+    }
+    return -1;
+}
+
+bool String::Value::regionMatches(bool ignoreCase, int offset, const CharSequence& other, int otherOffset,
+        int length) const {
+    const Value* that = other.cast_<Value>();
+    if (that == nullptr)
+        return CharSequence::Interface::regionMatches(ignoreCase, offset, other, otherOffset, length);
+    if ((offset < 0) || (otherOffset < 0) || (offset > count - length) || (otherOffset > that->count - length))
         return false;
-    for (int i = 0, n = length(); i < n; ++i) {
-        if (charAt(i) != that.charAt(i))
+    for (int i = 0; i < length; ++i) { // Compares segments, case is only considered on mismatch.
+        i += mismatch(offset + i, *that, otherOffset + i, length - i);
+        if (i >= length)
+            break;
+        if (!ignoreCase || !Character::equalsIgnoreCase(charAt(offset + i), that->charAt(otherOffset + i)))
             return false;
     }
     return true;
 }
 
-int String::Value::hashCode() const {
-    int h = 0;
-    for (int i = 0, n = length(); i < n; ++i) {
-        h = 31 * h + charAt(i);
+String String::Value::intern() const {
+    int h = hashCode();
+    InternTable::Stripe& stripe = InternTable::stripeOf(h);
+    std::lock_guard<std::mutex> guard(stripe.lock);
+    auto range = stripe.strings.equal_range(h);
+    for (auto i = range.first; i != range.second; ++i) {
+        if (equals(i->second))
+            return i->second;
     }
-    return h;
+    ensureFlat();
+    Value* canonical; // Does not retain a larger array (substring views).
+    if (compact) {
+        Array<unsigned char> chars = latin1;
+        if ((offset != 0) || (count != latin1.length)) {
+            chars = Array<unsigned char>::newInstance(count);
+            System::arraycopy(latin1, offset, chars, 0, count);
+        }
+        canonical = new Value(chars, Object::Value::IMMORTAL);
+    } else {
+        Array<Type::uchar> chars = uchars;
+        if ((offset != 0) || (count != uchars.length)) {
+            chars = Array<Type::uchar>::newInstance(count);
+            System::arraycopy(uchars, offset, chars, 0, count);
+        }
+        canonical = new Value(chars, Object::Value::IMMORTAL);
+    }
+    canonical->hash.store(h, std::memory_order_relaxed);
+    String str = canonical;
+    stripe.strings.emplace(h, str);
+    return str;
+}
+
+int String::Value::computeHash() const {
+    ensureFlat();
+    unsigned int h = 0; // Unsigned arithmetic (wraps around as Java int).
+    if (compact) {
+        latin1.forEachSegment(offset, offset + count, [&h](const unsigned char* segment, int n) {
+            h = hashSegment(h, segment, n);
+        });
+    } else {
+        uchars.forEachSegment(offset, offset + count, [&h](const Type::uchar* segment, int n) {
+            h = hashSegment(h, segment, n);
+        });
+    }
+    return (int) h;
 }
 
 Type::u8string String::Value::toUTF8() const {
-    static const int BUFFER_LENGTH = 1024;
-    int len = length();
-    if (len > BUFFER_LENGTH) { // Possible buffer overflow, split the work.
-        int half = len / 2;
-        return substring(0, half).toUTF8() + substring(half, len).toUTF8();
+    ensureFlat();
+    int len = count;
+    Type::u8string result;
+    if (compact) {
+        result.resize(2 * (std::size_t) len); // Upper bound, Latin-1 characters are encoded in at most 2 bytes.
+        char* out = &result[0];
+        latin1.forEachSegment(offset, offset + len, [&out](const unsigned char* segment, int n) {
+            int i = 0;
+            for (; i + 8 <= n; i += 8) { // Leading ASCII characters.
+                std::uint64_t word;
+                std::memcpy(&word, segment + i, sizeof(word));
+                if (word & 0x8080808080808080ULL)
+                    break;
+                std::memcpy(out, &word, sizeof(word));
+                out += 8;
+            }
+            for (; i < n; ++i) {
+                unsigned char c = segment[i];
+                if (c < 0x80) {
+                    *out++ = (char) c;
+                } else {
+                    *out++ = (char) (0xC0 | (c >> 6));
+                    *out++ = (char) (0x80 | (c & 0x3F));
+                }
+            }
+        });
+        result.resize(out - &result[0]);
+        return result;
     }
-    Type::uchar buffer[BUFFER_LENGTH];
-    for (int i = 0; i < len; ++i) buffer[i] = charAt(i); // TODO : Replace with Array::forEach
-    std::u16string u16(buffer, len);
-#ifdef JAVOLUTION_MSVC
-    // https://connect.microsoft.com/VisualStudio/feedback/details/1403302/unresolved-external-when-using-codecvt-utf8
-    std::wstring_convert<std::codecvt_utf8_utf16<int16_t>, int16_t> convert;
-    auto p = reinterpret_cast<const int16_t *>(u16.data());
-    return convert.to_bytes(p, p + u16.size());
-#else
-    return std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t>{}.to_bytes(u16);
-#endif
+    result.resize(3 * (std::size_t) len); // Upper bound, each UTF-16 character is encoded in at most 3 bytes.
+    char* out = &result[0];
+    Type::uchar high = 0;
+    uchars.forEachSegment(offset, offset + len, [&](const Type::uchar* segment, int n) {
+        out = encodeUTF8(segment, n, out, high);
+    });
+    if (high != 0) // Unpaired high surrogate at the end of the string.
+        *out++ = '?';
+    result.resize(out - &result[0]);
+    return result;
+}
+
+char* String::Value::encodeUTF8(const Type::uchar* in, int n, char* out, Type::uchar& high) {
+    const Kernels& kernels = Kernels::instance();
+    for (int i = 0; i < n;) {
+        Type::uchar uc = in[i];
+        if (high != 0) {
+            if ((uc >= 0xDC00) && (uc <= 0xDFFF)) { // Surrogate pair.
+                int cp = 0x10000 + ((high - 0xD800) << 10) + (uc - 0xDC00);
+                *out++ = (char) (0xF0 | (cp >> 18));
+                *out++ = (char) (0x80 | ((cp >> 12) & 0x3F));
+                *out++ = (char) (0x80 | ((cp >> 6) & 0x3F));
+                *out++ = (char) (0x80 | (cp & 0x3F));
+                high = 0;
+                ++i;
+                continue;
+            }
+            *out++ = '?';
+            high = 0;
+        }
+        if (uc < 0x80) {
+            int ascii = kernels.narrow(in + i, n - i, out);
+            if (ascii == 0) {
+                *out++ = (char) uc;
+                ascii = 1;
+            } else {
+                out += ascii;
+            }
+            i += ascii;
+            continue;
+        }
+        if (uc < 0x800) {
+            *out++ = (char) (0xC0 | (uc >> 6));
+            *out++ = (char) (0x80 | (uc & 0x3F));
+        } else if ((uc >= 0xD800) && (uc <= 0xDBFF)) {
+            high = uc;
+        } else if ((uc >= 0xDC00) && (uc <= 0xDFFF)) { // Unpaired low surrogate.
+            *out++ = '?';
+        } else {
+            *out++ = (char) (0xE0 | (uc >> 12));
+            *out++ = (char) (0x80 | ((uc >> 6) & 0x3F));
+            *out++ = (char) (0x80 | (uc & 0x3F));
+        }
+        ++i;
+    }
+    return out;
+}
+
+int String::Value::decodeUTF8(const char*& in, const char* end, Type::uchar* out, int n, Type::uchar& low) {
+    const Kernels& kernels = Kernels::instance();
+    Type::uchar* start = out;
+    Type::uchar* outEnd = out + n;
+    while ((out < outEnd) && (in < end)) {
+        unsigned char b = (unsigned char) *in;
+        if (b < 0x80) {
+            int ascii = kernels.widen(in, (int) std::min<std::ptrdiff_t>(end - in, outEnd - out), out);
+            if (ascii == 0) {
+                *out++ = b;
+                ascii = 1;
+            } else {
+                out += ascii;
+            }
+            in += ascii;
+            continue;
+        }
+        int length;
+        int cp;
+        if (b < 0xC2) { // Continuation byte or overlong two-bytes sequence.
+            throw IllegalArgumentException("Malformed UTF-8 input");
+        } else if (b < 0xE0) {
+            length = 2;
+            cp = b & 0x1F;
+        } else if (b < 0xF0) {
+            length = 3;
+            cp = b & 0x0F;
+        } else if (b < 0xF5) {
+            length = 4;
+            cp = b & 0x07;
+        } else {
+            throw IllegalArgumentException("Malformed UTF-8 input");
+        }
+        if (end - in < length)
+            throw IllegalArgumentException("Truncated UTF-8 input");
+        for (int i = 1; i < length; ++i) {
+            unsigned char c = (unsigned char) in[i];
+            if ((c & 0xC0) != 0x80)
+                throw IllegalArgumentException("Malformed UTF-8 input");
+            cp = (cp << 6) | (c & 0x3F);
+        }
+        if (((length == 3) && ((cp < 0x800) || ((cp >= 0xD800) && (cp <= 0xDFFF))))
+                || ((length == 4) && ((cp < 0x10000) || (cp > 0x10FFFF))))
+            throw IllegalArgumentException("Malformed UTF-8 input"); // Overlong, surrogate or out of range.
+        in += length;
+        if (cp < 0x10000) {
+            *out++ = (Type::uchar) cp;
+        } else {
+            cp -= 0x10000;
+            *out++ = (Type::uchar) (0xD800 + (cp >> 10));
+            Type::uchar lowSurrogate = (Type::uchar) (0xDC00 + (cp & 0x3FF));
+            if (out < outEnd) {
+                *out++ = lowSurrogate;
+            } else {
+                low = lowSurrogate;
+            }
+        }
+    }
+    return (int) (out - start);
 }
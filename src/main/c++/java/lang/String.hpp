@@ -5,6 +5,8 @@
  */
 #pragma once
 
+#include <atomic>
+#include <type_traits>
 #include <string>
 #include "java/lang/CharSequence.hpp"
 #include "java/lang/Array.hpp"
@@ -17,6 +19,12 @@ class StringBuilder;
 /**
  * A string of 16-bits Unicode characters (<code>Type::uchar</code>).
  *
+ * Strings whose characters are all Latin-1 (e.g. ASCII) are compact and hold one byte per character.
+ * Large substrings share the characters of the original string when they span at least a quarter of it
+ * (smaller substrings are copied to avoid retaining the original string). Large concatenations are lazy
+ * (rope), their characters are gathered on first access. Ropes are kept balanced: concatenating a rope creates
+ * a single node unless the rope becomes too deep for its length, in which case its unbalanced part is rebalanced.
+ *
  * This class supports autoboxing with <code>char*</code> (ASCII) and <code>Type::uchar*</code>,
  * e.g. <code>String str = u"Éléphant";</code>
  *
@@ -32,12 +40,113 @@ class StringBuilder;
  */
 class String final : public CharSequence {
 public:
+	class Literal;
+
 	class Value final : public Object::Value, public CharSequence::Interface {
+		friend class String;
 		friend class StringBuilder;
-		Array<Type::uchar> uchars;
-		Value(const Array<Type::uchar>& uchars) :
-				uchars(uchars) {
+		friend class Literal;
+		static const int MIN_VIEW_LENGTH = 64; // Shorter substrings are copied.
+		static const int MIN_ROPE_LENGTH = 256; // Shorter concatenations are copied.
+		static const int MAX_ROPE_DEPTH = 45; // Ropes this deep are never balanced (F(47) exceeds any length).
+		static const int ROPE_DEPTH_SLACK = 8; // Extra depth tolerated before concatenations rebalance.
+
+		mutable Array<Type::uchar> uchars; // UTF-16 characters (null if the string is compact or not flattened).
+		mutable Array<unsigned char> latin1; // Latin-1 characters (null if not compact or not flattened).
+		mutable int offset; // Index of the first character in the array (substring views).
+		const int count; // The number of characters.
+		const bool compact; // Indicates if all characters are Latin-1.
+		const int depth; // The rope depth when created (0 if the string was created flat).
+		mutable Object left; // The left string of a rope (null when flat).
+		mutable Object right; // The right string of a rope (null when flat).
+		mutable std::atomic<bool> flat; // Indicates if the characters array has been set.
+		mutable std::atomic<int> hash; // Cached hash code (0 if not computed yet).
+
+		Value(const Array<Type::uchar>& uchars, int offset, int count, RefCounting counting = SHARED) : // Not Latin-1.
+				Object::Value(counting), uchars(uchars), offset(offset), count(count), compact(false), depth(0),
+				flat(true), hash(0) {
+		}
+		Value(const Array<Type::uchar>& uchars, RefCounting counting = SHARED) :
+				Value(uchars, 0, uchars.length, counting) {
 		}
+		Value(const Array<unsigned char>& latin1, int offset, int count, RefCounting counting = SHARED) :
+				Object::Value(counting), latin1(latin1), offset(offset), count(count), compact(true), depth(0),
+				flat(true), hash(0) {
+		}
+		Value(const Array<unsigned char>& latin1, RefCounting counting = SHARED) :
+				Value(latin1, 0, latin1.length, counting) {
+		}
+		Value(const String& left, const String& right); // Rope.
+
+		/** Indicates if a substring of the specified length should share an array of the specified length
+		 *  (the substring is large enough with regard to the memory it retains). */
+		static bool isView(int length, int arrayLength) {
+			return (length >= MIN_VIEW_LENGTH) && (length >= (arrayLength >> 2));
+		}
+
+		/** Sets the characters array of a rope (on first access). */
+		void ensureFlat() const {
+			if (!flat.load(std::memory_order_acquire))
+				flatten();
+		}
+
+		void flatten() const;
+
+		int ropeDepth() const {
+			return flat.load(std::memory_order_acquire) ? 0 : depth;
+		}
+
+		/** Sets the strings of this rope; returns false if flat (flattened strings are leaves). */
+		bool children(String& leftString, String& rightString) const;
+
+		/** Returns the specified rope with the specified string merged to its right part (same depth) or null if
+		 *  that part is not a short flat string. */
+		static String mergeRight(const String& str, const String& that);
+
+		/** Indicates if the specified string is a balanced rope (or flat): a rope of depth <code>n</code> is
+		 *  balanced if its length is at least the Fibonacci number <code>F(n + 2 - slack)</code>. */
+		static bool isBalanced(const String& str, int slack = 0);
+
+		/** Returns the rope of the specified strings (either can be null). */
+		static String cat(const String& leftString, const String& rightString);
+
+		/** Rebalances the specified rope; its balanced parts are kept as is (Boehm, Atkinson and Plass). */
+		static String balance(const String& rope);
+
+		/** Inserts the balanced parts of the specified string in the specified forest (in order). */
+		static void insertBalanced(const String& str, String* forest);
+
+		/** Adds the specified balanced string to the specified forest; the entry <code>i</code> holds a balanced
+		 *  rope whose length is in <code>[F(i + 2), F(i + 3))</code>, the entries are in reverse order. */
+		static void addToForest(const String& str, String* forest);
+
+		/** Returns the string holding the specified UTF-16 characters range, compact if possible. The array is
+		 *  shared if the range cannot be compacted and is large enough (see isView). */
+		static String valueOf(const Array<Type::uchar>& uchars, int begin, int end);
+
+		/** Returns the Latin-1 characters of the specified UTF-16 range or null if any character is not Latin-1. */
+		static Array<unsigned char> compress(const Array<Type::uchar>& uchars, int begin, int end);
+
+		/** Returns true if all the characters in the specified range are Latin-1. */
+		static bool isLatin1(const Array<Type::uchar>& uchars, int begin, int end);
+
+		/** Copies the characters in the specified range (no bound checks). */
+		void getChars(int begin, int end, Type::uchar* dst) const;
+
+		/** Returns the index of the first different character in the specified regions or the regions length if
+		 *  the regions are equal (no bound checks). */
+		int mismatch(int offset, const Value& that, int thatOffset, int length) const;
+
+		int computeHash() const;
+
+		/** Encodes the specified UTF-16 segment, a high surrogate at the end of the segment is left in 'high'.
+		 *  Unpaired surrogates are replaced by '?' (as in Java). Returns the end of the output. */
+		static char* encodeUTF8(const Type::uchar* in, int n, char* out, Type::uchar& high);
+
+		/** Decodes UTF-8 bytes into the specified UTF-16 segment until the input is consumed or the segment is full;
+		 *  the low surrogate of a pair not fitting the segment is left in 'low'. Returns the number of characters
+		 *  written. @throws IllegalArgumentException if the input is not well-formed UTF-8. */
+		static int decodeUTF8(const char*& in, const char* end, Type::uchar* out, int n, Type::uchar& low);
 	public:
 
 		String substring(int beginIndex, int endIndex) const;
@@ -52,22 +161,48 @@ public:
 
 		bool equals(const String& that) const;
 
-		int hashCode() const override;
+		int compareTo(const String& that) const;
+
+		String intern() const;
+
+		int hashCode() const override {
+			int h = hash.load(std::memory_order_relaxed);
+			if (h == 0) { // Not computed yet (or hash is zero), concurrent computations yield the same value.
+				h = computeHash();
+				hash.store(h, std::memory_order_relaxed);
+			}
+			return h;
+		}
 
 		Type::u8string toUTF8() const;
 
 		Type::uchar charAt(int index) const override {
-			return uchars[index];
+			if ((index < 0) || (index >= count))
+				Object::Exceptions::throwArrayIndexOutOfBoundsException();
+			ensureFlat();
+			return compact ? latin1.this_<Array<unsigned char>::Value>()->elementAt(offset + index)
+					: uchars.this_<Array<Type::uchar>::Value>()->elementAt(offset + index);
 		}
 
 		int length() const override {
-			return uchars.length;
+			return count;
 		}
 
 		CharSequence subSequence(int start, int end) const override {
 			return substring(start, end);
 		}
 
+		int indexOf(Type::uchar ch, int fromIndex) const override;
+
+		int lastIndexOf(Type::uchar ch, int fromIndex) const override;
+
+		int indexOf(const CharSequence& str, int fromIndex) const override;
+
+		int lastIndexOf(const CharSequence& str, int fromIndex) const override;
+
+		bool regionMatches(bool ignoreCase, int offset, const CharSequence& other, int otherOffset, int length) const
+				override;
+
   		String toString() const override {
 			return const_cast<Value*>(this);
 		}
@@ -75,6 +210,35 @@ public:
 
 	CLASS_BASE(String, CharSequence)
 
+	/**
+	 * A string constant statically allocated (ASCII characters only). The literal characters are copied once at
+	 * construction and the string value is immortal; no allocation and no reference counting is performed when
+	 * the literal is converted to a string.
+	 * <pre><code>
+	 * static const String::Literal ELLIPSIS("...");
+	 * ...
+	 * String str = ELLIPSIS; // No allocation.
+	 * </code></pre>
+	 */
+	class Literal final {
+		std::aligned_storage<sizeof(Value), alignof(Value)>::type value; // Never destructed.
+	public:
+
+		/**
+		 * Creates a literal for the specified null terminated characters (copied).
+		 *
+		 * @throws IllegalArgumentException if any character is not an ASCII character.
+		 */
+		explicit Literal(const char* chars);
+
+		Literal(const Literal&) = delete;
+		Literal& operator=(const Literal&) = delete;
+
+		operator String() const {
+			return reinterpret_cast<Value*>(&const_cast<Literal*>(this)->value);
+		}
+	};
+
 	/**
 	 * Returns the string representing the specified object ("null" if (obj == nullptr)).
 	 */
@@ -96,6 +260,8 @@ public:
 
 	/**
 	 * Returns the string holding the specified UTF-8 characters.
+	 *
+	 * @throws IllegalArgumentException if the specified string is not well-formed UTF-8.
 	 */
 	static String valueOf(const Type::u8string& str);
 
@@ -182,6 +348,69 @@ public:
 		return this_<Value>()->endsWith(suffix);
 	}
 
+	/**
+	 * Returns the index of the first occurrence of the specified character at or after the specified index
+	 * (-1 if none). UTF-16 strings are searched using SIMD instructions when available.
+	 */
+	int indexOf(Type::uchar ch, int fromIndex = 0) const {
+		return this_<Value>()->indexOf(ch, fromIndex);
+	}
+
+	/**
+	 * Returns the index of the last occurrence of the specified character at or before the specified index
+	 * (-1 if none).
+	 */
+	int lastIndexOf(Type::uchar ch, int fromIndex = std::numeric_limits<int>::max()) const {
+		return this_<Value>()->lastIndexOf(ch, fromIndex);
+	}
+
+	/**
+	 * Returns the index of the first occurrence of the specified string at or after the specified index
+	 * (-1 if none). The search is linear in time (Two-Way algorithm) and does not allocate memory for substrings
+	 * of up to 128 characters.
+	 */
+	int indexOf(const String& str, int fromIndex = 0) const {
+		return this_<Value>()->indexOf(str, fromIndex);
+	}
+
+	/**
+	 * Returns the index of the last occurrence of the specified string at or before the specified index
+	 * (-1 if none).
+	 */
+	int lastIndexOf(const String& str, int fromIndex = std::numeric_limits<int>::max()) const {
+		return this_<Value>()->lastIndexOf(str, fromIndex);
+	}
+
+	/**
+	 * Indicates if this string contains the specified character sequence.
+	 */
+	bool contains(const CharSequence& str) const {
+		return this_<Value>()->indexOf(str, 0) >= 0;
+	}
+
+	/**
+	 * Indicates if this string contains the specified string.
+	 */
+	bool contains(const String& str) const {
+		return indexOf(str, 0) >= 0;
+	}
+
+	/**
+	 * Tests if the specified regions of this string and of the specified string are equal; returns false if any
+	 * region is out of range.
+	 */
+	bool regionMatches(int offset, const String& other, int otherOffset, int length) const {
+		return this_<Value>()->regionMatches(false, offset, other, otherOffset, length);
+	}
+
+	/**
+	 * Tests if the specified regions of this string and of the specified string are equal, ignoring case
+	 * differences if requested (see Character::equalsIgnoreCase); returns false if any region is out of range.
+	 */
+	bool regionMatches(bool ignoreCase, int offset, const String& other, int otherOffset, int length) const {
+		return this_<Value>()->regionMatches(ignoreCase, offset, other, otherOffset, length);
+	}
+
 	/**
 	 * Indicates whether the specified object is a string holding the same characters as this string.
 	 */
@@ -196,6 +425,23 @@ public:
 		return this_<Value>()->equals(that);
 	}
 
+	/**
+	 * Returns a canonical representation for this string; for any two strings <code>s</code> and <code>t</code>,
+	 * <code>s.intern() == t.intern()</code> if and only if <code>s.equals(t)</code>. Interned strings are immortal
+	 * (never deleted and not reference counted).
+	 */
+	String intern() const {
+		return this_<Value>()->intern();
+	}
+
+	/**
+	 * Compares two strings lexicographically (UTF-16 characters values). Returns the difference of the first
+	 * different characters or the difference of lengths if one string is a prefix of the other.
+	 */
+	int compareTo(const String& that) const {
+		return this_<Value>()->compareTo(that);
+	}
+
 	/**
 	 * Returns a UTF-8 string corresponding to this string object (can be used for serialization purpose).
 	 */
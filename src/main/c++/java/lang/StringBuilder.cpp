@@ -4,81 +4,453 @@
  * All rights reserved.
  */
 
-#include <locale>
-#include <codecvt>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
 #include "java/lang/StringBuilder.hpp"
 #include "java/lang/System.hpp"
 
-StringBuilder StringBuilder::Value::append(Type::uchar uc) {
+void StringBuilder::Value::ensureCapacity(int minimumCapacity) {
     if (immutable) {
         uchars = uchars.clone();
         immutable = false;
+        tailEnd = 0;
+    }
+    if (minimumCapacity > uchars.length) {
+        int newCapacity = (uchars.length << 1) + 2; // Geometric growth.
+        if ((newCapacity < minimumCapacity) || (newCapacity < 0)) // Overflow.
+            newCapacity = minimumCapacity;
+        uchars.setLength(newCapacity);
+        tailEnd = 0;
     }
-    if (count >= uchars.length)
-        uchars.setLength(uchars.length + CHARS_INC);
-    uchars[count++] = uc;
+}
+
+String StringBuilder::Value::toString() const {
+    Array<unsigned char> latin1 = String::Value::compress(uchars, 0, count);
+    if (latin1 != nullptr)
+        return new String::Value(latin1);
+    Value* self = const_cast<Value*>(this); // Removes constness.
+    self->uchars.length = count; // Ok, small reduction adjustment (no need to call setLength).
+    self->immutable = true;
+    self->tailEnd = 0;
+    return new String::Value(self->uchars); // Share the same array.
+}
+
+StringBuilder StringBuilder::Value::append(Type::uchar uc) {
+    if (count >= tailEnd) { // Moves to the next segment.
+        ensureCapacity(count + 1);
+        int segmentLength;
+        tail = uchars.this_<Array<Type::uchar>::Value>()->segmentAt(count, segmentLength);
+        tailEnd = std::min(count + segmentLength, uchars.length);
+    }
+    *tail++ = uc;
+    ++count;
     return this;
 }
 
 StringBuilder StringBuilder::Value::append(const String& str) {
     if (str == nullptr)
         return append("null");
-    if (immutable) {
-        uchars = uchars.clone();
-        immutable = false;
+    const String::Value* value = str.this_<String::Value>();
+    int strLength = value->length();
+    ensureCapacity(count + strLength);
+    value->ensureFlat();
+    if (!value->compact) {
+        System::arraycopy(value->uchars, value->offset, uchars, count, strLength);
+    } else {
+        int pos = 0;
+        uchars.forEachSegment(count, count + strLength, [&](Type::uchar* segment, int n) {
+            value->getChars(pos, pos + n, segment);
+            pos += n;
+        });
     }
-    int strLength = str.length();
-    if (count + strLength > uchars.length)
-        uchars.setLength(uchars.length + strLength + CHARS_INC);
-    System::arraycopy(str.this_<String::Value>()->uchars, 0, uchars, count, strLength);
     count += strLength;
+    tailEnd = 0;
     return this;
 }
 
 StringBuilder StringBuilder::Value::append(const Type::uchar* chars) {
-    if (immutable) {
-        uchars = uchars.clone();
-        immutable = false;
-    }
-    for (int i = 0;;) {
-        Type::uchar uc = chars[i++];
-        if (uc == 0)
-            break;
-        if (count >= uchars.length)
-            uchars.setLength(uchars.length + CHARS_INC);
-        uchars[count++] = uc;
-    }
+    int length = (int) std::char_traits<Type::uchar>::length(chars);
+    ensureCapacity(count + length);
+    uchars.forEachSegment(count, count + length, [&chars](Type::uchar* segment, int n) {
+        std::copy(chars, chars + n, segment);
+        chars += n;
+    });
+    count += length;
+    tailEnd = 0;
     return this;
 }
 
 StringBuilder StringBuilder::Value::append(const char* chars) {
-    if (immutable) {
-        uchars = uchars.clone();
-        immutable = false;
+    int length = (int) std::strlen(chars);
+    ensureCapacity(count + length);
+    uchars.forEachSegment(count, count + length, [&chars](Type::uchar* segment, int n) {
+        for (int i = 0; i < n; ++i) {
+            unsigned char c = (unsigned char) *chars++;
+            if (c > 0x7f)
+                throw IllegalArgumentException("Illegal non-ASCII character");
+            segment[i] = (Type::uchar) c;
+        }
+    });
+    count += length;
+    tailEnd = 0;
+    return this;
+}
+
+StringBuilder StringBuilder::Value::appendASCII(const char* chars, int length) {
+    ensureCapacity(count + length);
+    uchars.forEachSegment(count, count + length, [&chars](Type::uchar* segment, int n) {
+        for (int i = 0; i < n; ++i)
+            segment[i] = (Type::uchar) *chars++;
+    });
+    count += length;
+    tailEnd = 0;
+    return this;
+}
+
+static const char DIGIT_PAIRS[] = // Two digits at a time.
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+StringBuilder StringBuilder::Value::append(long long value) {
+    char buffer[20]; // Sign and up to 19 digits.
+    char* end = buffer + sizeof(buffer);
+    char* start = end;
+    unsigned long long magnitude = (value < 0) ? 0ULL - (unsigned long long) value : (unsigned long long) value;
+    while (magnitude >= 100) {
+        int pair = (int) (magnitude % 100) * 2;
+        magnitude /= 100;
+        *--start = DIGIT_PAIRS[pair + 1];
+        *--start = DIGIT_PAIRS[pair];
     }
-    for (int i = 0;;) {
-        unsigned char c = (unsigned char) chars[i++];
-        if (c > 0x7f)
-            throw IllegalArgumentException("Illegal non-ASCII character");
-        if (c == 0)
-            break;
-        if (count >= uchars.length)
-            uchars.setLength(uchars.length + CHARS_INC);
-        uchars[count++] = (Type::uchar) c;
+    if (magnitude >= 10) {
+        int pair = (int) magnitude * 2;
+        *--start = DIGIT_PAIRS[pair + 1];
+        *--start = DIGIT_PAIRS[pair];
+    } else {
+        *--start = (char) ('0' + magnitude);
     }
-    return this;
+    if (value < 0)
+        *--start = '-';
+    return appendASCII(start, (int) (end - start));
 }
 
-StringBuilder StringBuilder::Value::append(const Type::u8string& str) {
-#ifdef JAVOLUTION_MSVC
-    // https://connect.microsoft.com/VisualStudio/feedback/details/1403302/unresolved-external-when-using-codecvt-utf8
-    std::wstring_convert<std::codecvt_utf8_utf16<int16_t>, int16_t> convert;
-    std::basic_string<int16_t> u16 = convert.from_bytes(str);
-    auto p = reinterpret_cast<const Type::uchar *>(u16.c_str());
-    return append(p);
+/** Returns the number of bits of <code>5^e</code>, i.e. <code>floor(log2(5^e)) + 1</code> (0 <= e <= 3528). */
+static int pow5Bits(int e) {
+    return (int) (((std::uint32_t) e * 1217359) >> 19) + 1;
+}
+
+/** Returns <code>floor(log10(2^e))</code> (0 <= e <= 1650). */
+static int log10Pow2(int e) {
+    return (int) (((std::uint32_t) e * 78913) >> 18);
+}
+
+/** Returns <code>floor(log10(5^e))</code> (0 <= e <= 2620). */
+static int log10Pow5(int e) {
+    return (int) (((std::uint32_t) e * 732923) >> 20);
+}
+
+static bool isMultipleOfPow5(std::uint64_t value, int p) {
+    int count = 0;
+    for (; (value % 5 == 0) && (count < p); value /= 5)
+        ++count;
+    return count >= p;
+}
+
+static bool isMultipleOfPow2(std::uint64_t value, int p) {
+    return (value & ((std::uint64_t(1) << p) - 1)) == 0;
+}
+
+/**
+ * The powers of five used to find the shortest digits of floating point values: <code>pow5[i]</code> holds the
+ * 125 most significant bits of <code>5^i</code> and <code>pow5Inv[i]</code> the 125 most significant bits of
+ * <code>1/5^i</code> plus one ({low, high} words). They are computed once, with exact multi-precision arithmetic,
+ * instead of being stored as literal tables.
+ */
+struct Pow5Table {
+    static const int BITS = 125;
+    static const int POW5_COUNT = 327; // Up to 5^326 (smallest subnormal double and one more digit).
+    static const int POW5_INV_COUNT = 342; // Up to 1/5^341 (largest double).
+    static const int LIMBS = 33; // Multi-precision numbers of 1056 bits (2^1024 and 5^341 fit).
+
+    std::uint64_t pow5[POW5_COUNT][2];
+    std::uint64_t pow5Inv[POW5_INV_COUNT][2];
+
+    Pow5Table() {
+        std::uint32_t power[LIMBS] = { 1 }; // 5^i
+        std::uint32_t inverse[LIMBS] = { }; // floor(2^1024 / 5^i)
+        inverse[LIMBS - 1] = 1;
+        for (int i = 0; i < POW5_INV_COUNT; ++i) {
+            int bits = pow5Bits(i);
+            if (i < POW5_COUNT)
+                extract(power, bits - BITS, pow5[i]);
+            extract(inverse, 1024 - (bits - 1 + BITS), pow5Inv[i]);
+            if (++pow5Inv[i][0] == 0)
+                ++pow5Inv[i][1];
+            std::uint64_t carry = 0;
+            for (int j = 0; j < LIMBS; ++j) {
+                carry += (std::uint64_t) power[j] * 5;
+                power[j] = (std::uint32_t) carry;
+                carry >>= 32;
+            }
+            std::uint64_t remainder = 0;
+            for (int j = LIMBS - 1; j >= 0; --j) {
+                remainder = (remainder << 32) | inverse[j];
+                inverse[j] = (std::uint32_t) (remainder / 5);
+                remainder %= 5;
+            }
+        }
+    }
+
+    /** Sets the 128 bits of the specified number starting at the specified bit (a negative start shifts left). */
+    static void extract(const std::uint32_t* number, int start, std::uint64_t* words) {
+        words[0] = words[1] = 0;
+        for (int i = 0; i < 128; ++i) {
+            int bit = start + i;
+            if ((bit >= 0) && (bit < LIMBS * 32) && ((number[bit >> 5] >> (bit & 31)) & 1))
+                words[i >> 6] |= std::uint64_t(1) << (i & 63);
+        }
+    }
+
+    static const Pow5Table& instance() {
+        static const Pow5Table table;
+        return table;
+    }
+};
+
+/** Returns <code>(m * factor) >> shift</code> for a 128 bits factor ({low, high} words), 64 <= shift < 128. */
+static std::uint64_t mulShift(std::uint64_t m, const std::uint64_t* factor, int shift) {
+#if defined(__SIZEOF_INT128__)
+    typedef unsigned __int128 uint128;
+    return (std::uint64_t) (((((uint128) m * factor[0]) >> 64) + (uint128) m * factor[1]) >> (shift - 64));
 #else
-    std::u16string u16_conv = std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> { }.from_bytes(str);
-    return append(u16_conv.c_str());
+    std::uint64_t low = (std::uint32_t) m, high = m >> 32;
+    std::uint64_t products[2][2]; // {low, high} words of m * factor[i].
+    for (int i = 0; i < 2; ++i) {
+        std::uint64_t ll = low * (std::uint32_t) factor[i], lh = low * (factor[i] >> 32);
+        std::uint64_t hl = high * (std::uint32_t) factor[i], hh = high * (factor[i] >> 32);
+        std::uint64_t middle = (ll >> 32) + (std::uint32_t) lh + (std::uint32_t) hl;
+        products[i][0] = (middle << 32) | (std::uint32_t) ll;
+        products[i][1] = hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+    }
+    std::uint64_t sumLow = products[1][0] + products[0][1];
+    std::uint64_t sumHigh = products[1][1] + (sumLow < products[0][1]);
+    shift -= 64;
+    return (shift == 0) ? sumLow : (sumLow >> shift) | (sumHigh << (64 - shift));
 #endif
 }
 
+/**
+ * Sets the shortest decimal digits <code>output</code> uniquely distinguishing the finite positive value
+ * <code>m2 * 2^e2</code> and returns their decimal exponent (Ulf Adams, "Ryu: fast float-to-string conversion",
+ * 2018). The bounds of the rounding interval of the value are halfway to its neighbors, the lower one being closer
+ * if <code>mmShift</code> is false (the value is a power of two). At least two digits are kept: when a single
+ * digit would do, the closest two digits decimal is selected (as Java does).
+ */
+static int shortestDigits(std::uint64_t m2, int e2, bool mmShift, std::uint64_t& output) {
+    const Pow5Table& table = Pow5Table::instance();
+    bool acceptBounds = (m2 & 1) == 0; // Parsers round half to even.
+    std::uint64_t mv = 4 * m2; // Two more bits for the bounds.
+    std::uint64_t mp = mv + 2;
+    std::uint64_t mm = mv - 1 - mmShift;
+    e2 -= 2;
+    std::uint64_t vr, vp, vm; // The value and its bounds scaled by 10^-e10 (truncated).
+    int e10;
+    bool vmIsTrailingZeros = false; // Indicates if the digits removed from vm are all zeros.
+    bool vrIsTrailingZeros = false; // Indicates if the digits removed from vr (but the last one) are all zeros.
+    if (e2 >= 0) {
+        int q = log10Pow2(e2) - (e2 > 3);
+        int shift = -e2 + q + Pow5Table::BITS + pow5Bits(q) - 1;
+        e10 = q;
+        vr = mulShift(mv, table.pow5Inv[q], shift);
+        vp = mulShift(mp, table.pow5Inv[q], shift);
+        vm = mulShift(mm, table.pow5Inv[q], shift);
+        if (q <= 21) { // Larger powers of five do not divide mv.
+            if (mv % 5 == 0)
+                vrIsTrailingZeros = isMultipleOfPow5(mv, q);
+            else if (acceptBounds)
+                vmIsTrailingZeros = isMultipleOfPow5(mm, q);
+            else
+                vp -= isMultipleOfPow5(mp, q);
+        }
+    } else {
+        int q = log10Pow5(-e2) - (-e2 > 1);
+        int i = -e2 - q;
+        int shift = q - pow5Bits(i) + Pow5Table::BITS;
+        e10 = q + e2;
+        vr = mulShift(mv, table.pow5[i], shift);
+        vp = mulShift(mp, table.pow5[i], shift);
+        vm = mulShift(mm, table.pow5[i], shift);
+        if (vr < 100) { // Tiny subnormal, the two digits are rounded to nearest using the next one.
+            std::uint64_t next = mulShift(mv, table.pow5[i + 1], q - 1 - pow5Bits(i + 1) + Pow5Table::BITS);
+            output = next / 10 + (next % 10 >= 5);
+            return e10;
+        }
+        if (q <= 1) { // mv, mp and mm have at least two trailing zero bits.
+            vrIsTrailingZeros = true;
+            if (acceptBounds)
+                vmIsTrailingZeros = mmShift;
+            else
+                --vp;
+        } else if (q < 63) {
+            vrIsTrailingZeros = isMultipleOfPow2(mv, q);
+        }
+    }
+    int removed = 0;
+    if (vmIsTrailingZeros || vrIsTrailingZeros) { // The value may be exactly halfway or on its lower bound.
+        int lastRemovedDigit = 0;
+        for (; (vp / 10 > vm / 10) && (vr >= 100); ++removed) {
+            vmIsTrailingZeros &= (vm % 10 == 0);
+            vrIsTrailingZeros &= (lastRemovedDigit == 0);
+            lastRemovedDigit = (int) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+        }
+        for (; vmIsTrailingZeros && (vm % 10 == 0) && (vr >= 100); ++removed) {
+            vrIsTrailingZeros &= (lastRemovedDigit == 0);
+            lastRemovedDigit = (int) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+        }
+        if (vrIsTrailingZeros && (lastRemovedDigit == 5) && (vr % 2 == 0))
+            lastRemovedDigit = 4; // Exactly halfway, rounds to even.
+        output = vr + (((vr == vm) && (!acceptBounds || !vmIsTrailingZeros)) || (lastRemovedDigit >= 5));
+    } else {
+        bool roundUp = false;
+        for (; (vp / 10 > vm / 10) && (vr >= 100); ++removed) {
+            roundUp = (vr % 10 >= 5);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+        }
+        output = vr + ((vr == vm) || roundUp);
+    }
+    return e10 + removed;
+}
+
+/**
+ * Formats the specified finite floating point value as Java does (Double.toString / Float.toString) and returns the
+ * number of characters written (at most 32). The digits are the shortest decimal uniquely distinguishing the value
+ * (see shortestDigits), computed with integer arithmetic only.
+ */
+template<typename T> static int formatFloat(T value, char* out) {
+    typedef typename std::conditional<sizeof(T) == 8, std::uint64_t, std::uint32_t>::type Bits;
+    const int mantissaBits = std::numeric_limits<T>::digits - 1;
+    const int bias = std::numeric_limits<T>::max_exponent - 1;
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    char* start = out;
+    if (std::signbit(value)) {
+        *out++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        std::memcpy(out, "0.0", 3);
+        return (int) (out - start) + 3;
+    }
+    std::uint64_t mantissa = bits & ((Bits(1) << mantissaBits) - 1);
+    int biasedExponent = (int) (bits >> mantissaBits) & (2 * bias + 1);
+    std::uint64_t output;
+    int exponent = (biasedExponent == 0) ? // Subnormal.
+            shortestDigits(mantissa, 1 - bias - mantissaBits, true, output) :
+            shortestDigits((std::uint64_t(1) << mantissaBits) | mantissa, biasedExponent - bias - mantissaBits,
+                    (mantissa != 0) || (biasedExponent <= 1), output);
+    char digits[20]; // Significant digits (value = d0.d1d2... * 10^exponent).
+    int n = 0;
+    for (std::uint64_t i = output; i != 0; i /= 10)
+        ++n;
+    exponent += n - 1;
+    for (int i = n - 1; i >= 0; --i, output /= 10)
+        digits[i] = (char) ('0' + output % 10);
+    while ((n > 1) && (digits[n - 1] == '0'))
+        --n;
+    if ((exponent >= -3) && (exponent < 7)) { // Plain notation.
+        if (exponent < 0) {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = exponent + 1; i < 0; ++i)
+                *out++ = '0';
+            std::memcpy(out, digits, n);
+            out += n;
+        } else {
+            for (int i = 0; i <= exponent; ++i)
+                *out++ = (i < n) ? digits[i] : '0';
+            *out++ = '.';
+            if (n > exponent + 1) {
+                std::memcpy(out, digits + exponent + 1, n - exponent - 1);
+                out += n - exponent - 1;
+            } else {
+                *out++ = '0';
+            }
+        }
+    } else { // Computerized scientific notation.
+        *out++ = digits[0];
+        *out++ = '.';
+        if (n > 1) {
+            std::memcpy(out, digits + 1, n - 1);
+            out += n - 1;
+        } else {
+            *out++ = '0';
+        }
+        *out++ = 'E';
+        if (exponent < 0) {
+            *out++ = '-';
+            exponent = -exponent;
+        }
+        if (exponent >= 100)
+            *out++ = (char) ('0' + exponent / 100);
+        if (exponent >= 10)
+            *out++ = (char) ('0' + (exponent / 10) % 10);
+        *out++ = (char) ('0' + exponent % 10);
+    }
+    return (int) (out - start);
+}
+
+StringBuilder StringBuilder::Value::append(double value) {
+    if (value != value)
+        return appendASCII("NaN", 3);
+    if (std::isinf(value))
+        return (value > 0) ? appendASCII("Infinity", 8) : appendASCII("-Infinity", 9);
+    char buffer[32];
+    return appendASCII(buffer, formatFloat(value, buffer));
+}
+
+StringBuilder StringBuilder::Value::append(float value) {
+    if (value != value)
+        return appendASCII("NaN", 3);
+    if (std::isinf(value))
+        return (value > 0) ? appendASCII("Infinity", 8) : appendASCII("-Infinity", 9);
+    char buffer[32];
+    return appendASCII(buffer, formatFloat(value, buffer));
+}
+
+StringBuilder StringBuilder::Value::append(const Type::u8string& str) {
+    ensureCapacity(count + (int) str.size()); // The UTF-16 length is at most the UTF-8 length.
+    const char* in = str.data();
+    const char* end = in + str.size();
+    int length = count; // Updated once the whole input has been validated.
+    Type::uchar low = 0;
+    while ((in < end) || (low != 0)) {
+        int segmentLength;
+        Type::uchar* segment = uchars.this_<Array<Type::uchar>::Value>()->segmentAt(length, segmentLength);
+        segmentLength = std::min(segmentLength, uchars.length - length);
+        int n = 0;
+        if (low != 0) { // Low surrogate of a pair split between segments.
+            segment[n++] = low;
+            low = 0;
+        }
+        n += String::Value::decodeUTF8(in, end, segment + n, segmentLength - n, low);
+        length += n;
+    }
+    count = length;
+    tailEnd = 0;
+    return this;
+}
+
@@ -5,7 +5,6 @@
  */
 #pragma once
 
-#include <sstream>
 #include "java/lang/Object.hpp"
 #include "java/lang/String.hpp"
 #include "java/lang/Boolean.hpp"
@@ -30,12 +29,28 @@ namespace lang {
 class StringBuilder final : public CharSequence {
 public:
 	class Value final : public Object::Value, public CharSequence::Interface {
-		static const int CHARS_INC = 32; // Smooth length increment.
 		Array<Type::uchar> uchars = Array<Type::uchar>::newInstance();
 		int count = 0;
-		bool immutable = false; // Becomes immutable after toString() is called since the array will be shared.
+		bool immutable = false; // Becomes immutable when toString() shares the array (non Latin-1 characters).
+		Type::uchar* tail = nullptr; // Address of the next character in the current segment.
+		int tailEnd = 0; // End of the current segment (0 if the segment has to be recomputed).
+
+		StringBuilder appendASCII(const char* chars, int length); // No validation.
 	public:
 
+		Value() {
+		}
+
+		Value(int capacity) :
+				uchars(Array<Type::uchar>::newInstance(capacity)) {
+		}
+
+		void ensureCapacity(int minimumCapacity);
+
+		int capacity() const {
+			return immutable ? count : uchars.length;
+		}
+
 		StringBuilder append(Type::uchar uc);
 
 		StringBuilder append(const String& str);
@@ -46,6 +61,12 @@ public:
 
         StringBuilder append(const Type::u8string& str);
 
+		StringBuilder append(long long value);
+
+		StringBuilder append(double value);
+
+		StringBuilder append(float value);
+
 		Type::uchar charAt(int index) const override {
 			if (index >= count)
 				throw IndexOutOfBoundsException();
@@ -60,12 +81,7 @@ public:
 			return toString().substring(start, end);
 		}
 
-		String toString() const override {
-			Value* self = const_cast<Value*>(this); // Removes constness.
-			self->uchars.length = count; // Ok, small reduction adjustment (no need to call setLength).
-			self->immutable = true;
-			return new String::Value(self->uchars); // Share the same array.
-		}
+		String toString() const override; // Compact string if possible, otherwise shares the builder array.
 
 		bool equals(const Object& other) const override {
 	        return Object::Value::equals(other);
@@ -78,6 +94,28 @@ public:
 
 	CLASS_BASE(StringBuilder, CharSequence)
 
+	/**
+	 * Creates a string builder with the specified initial capacity (in characters).
+	 */
+	explicit StringBuilder(int capacity) :
+			StringBuilder(new Value(capacity)) {
+	}
+
+	/**
+	 * Ensures that the capacity is at least equal to the specified minimum. The capacity grows geometrically
+	 * (amortized constant time appends).
+	 */
+	void ensureCapacity(int minimumCapacity) {
+		this_<Value>()->ensureCapacity(minimumCapacity);
+	}
+
+	/**
+	 * Returns the number of characters which can be appended without growing this builder internal array.
+	 */
+	int capacity() const {
+		return this_<Value>()->capacity();
+	}
+
 	/**
 	 * Appends the textual representation of the specified object.
 	 */
@@ -96,45 +134,36 @@ public:
 	 * Appends the specified int value.
 	 */
 	StringBuilder append(int value) {
-		std::ostringstream out;
-		out << value;
-		return append(out.str());
+		return this_<Value>()->append((long long) value);
 	}
 
 	/**
 	 * Appends the specified long value.
 	 */
 	StringBuilder append(long value) {
-		std::ostringstream out;
-		out << value;
-		return append(out.str());
+		return this_<Value>()->append((long long) value);
 	}
 
 	/**
 	 * Appends the specified long long value (at least 64 bits).
 	 */
 	StringBuilder append(long long value) {
-		std::ostringstream out;
-		out << value;
-		return append(out.str());
+		return this_<Value>()->append(value);
 	}
 
 	/**
-	 * Appends the specified 32 bits float value.
+	 * Appends the specified 32 bits float value (same representation as Java <code>Float.toString</code>).
 	 */
 	StringBuilder append(float value) {
-		std::ostringstream out;
-		out << value;
-		return append(out.str());
+		return this_<Value>()->append(value);
 	}
 
 	/**
-	 * Appends the specified 64 bits float value.
+	 * Appends the specified 64 bits float value (same representation as Java <code>Double.toString</code>, the
+	 * shortest decimal uniquely distinguishing the value).
 	 */
 	StringBuilder append(double value) {
-		std::ostringstream out;
-		out << value;
-		return append(out.str());
+		return this_<Value>()->append(value);
 	}
 
 	/**
@@ -148,6 +177,8 @@ public:
 
     /**
      * Appends the specified UTF-8 characters (string).
+     *
+     * @throws IllegalArgumentException if the specified string is not well-formed UTF-8.
      */
     StringBuilder append(const Type::u8string& str) {
         return this_<Value>()->append(str);
@@ -5,6 +5,9 @@
  */
 #pragma once
 
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
 #include "java/lang/String.hpp"
 #include "java/lang/Class.hpp"
 #include "java/lang/IndexOutOfBoundsException.hpp"
@@ -82,7 +85,9 @@ public:
 	/**
 	 * Copies an array from the specified source array, beginning at the specified position, to the specified
 	 * position of the destination array. This method ensures that copy constructors of the array elements (if any)
-	 * are being called.
+	 * are being called. Source and destination segments are copied together (trivially copyable elements are moved
+	 * using memmove); if the source and destination are the same array, the copy is performed as if the elements
+	 * were first copied to a temporary array.
 	 *
 	 * @throws IndexOutOfBoundsException if <code>(srcPos+length &gt; src.length)
 	 *          || (dstPos+length &gt; dst.length)</code>
@@ -92,8 +97,29 @@ public:
 				|| (dstPos + length > dst.length))
 			throw IndexOutOfBoundsException("srcPos: " + String::valueOf(srcPos) +
 			        ", dstPos: " + String::valueOf(dstPos) + ", length: " + String::valueOf(length));
-		for (int i = 0; i < length; ++i) {
-			dst[dstPos + i] = src[srcPos + i]; // TODO: Use forEach(lambda)
+		if (length == 0)
+			return;
+		typedef typename Array<E>::Value Value;
+		const Value* srcValue = src.template this_<Value>();
+		Value* dstValue = dst.template this_<Value>();
+		if ((srcValue == dstValue) && (srcPos < dstPos) && (srcPos + length > dstPos)) { // Overlap, copies backward.
+			const int MASK = Array<E>::SEGMENT_SIZE - 1;
+			for (int srcEnd = srcPos + length, dstEnd = dstPos + length; dstEnd > dstPos;) {
+				int n = std::min(std::min(((srcEnd - 1) & MASK) + 1, ((dstEnd - 1) & MASK) + 1), dstEnd - dstPos);
+				srcEnd -= n;
+				dstEnd -= n;
+				int count;
+				copySegment(srcValue->segmentAt(srcEnd, count), dstValue->segmentAt(dstEnd, count), n, true);
+			}
+			return;
+		}
+		for (int i = 0; i < length;) {
+			int srcCount, dstCount;
+			const E* srcSegment = srcValue->segmentAt(srcPos + i, srcCount);
+			E* dstSegment = dstValue->segmentAt(dstPos + i, dstCount);
+			int n = std::min(std::min(srcCount, dstCount), length - i);
+			copySegment(srcSegment, dstSegment, n, false);
+			i += n;
 		}
 	}
 
@@ -101,6 +127,18 @@ public:
 	 *  midnight, January 1, 1970 UTC). */
 	static Type::int64 currentTimeMillis();
 
+private:
+
+	template<typename E> static void copySegment(const E* src, E* dst, int n, bool backward) {
+		if (std::is_trivially_copyable<E>::value) {
+			std::memmove(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(E));
+		} else if (backward) {
+			std::copy_backward(src, src + n, dst + n);
+		} else {
+			std::copy(src, src + n, dst);
+		}
+	}
+
 };
 
 }
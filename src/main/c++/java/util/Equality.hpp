@@ -0,0 +1,103 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include "java/lang/Object.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * The equality trait used by hash collections (e.g. FastMap) to hash and compare their keys.
+ *
+ * <p> By default, the <code>hashCode()</code> and <code>equals(...)</code> methods of the key type are used; this
+ *     applies to objects (e.g. String), value types (e.g. Integer, Character) and any class following the same
+ *     convention. Primitive keys are hashed as their boxed Java counterparts (e.g. <code>true</code> as 1231, a
+ *     <code>float</code> as its <code>floatToIntBits</code>) and floating point keys are compared by bit patterns,
+ *     as Java's Double.equals does. Custom equalities can be specified as template parameter of the
+ *     collections.</p>
+ *
+ * <pre><code>
+ * struct CaseInsensitive {
+ *     static int hashOf(const String& str) { ... }
+ *     static bool areEqual(const String& left, const String& right) { ... }
+ * };
+ * FastMap<String, Integer, CaseInsensitive> headers = new FastMap<String, Integer, CaseInsensitive>::Value();
+ * </code></pre>
+ *
+ * @see  <a href="http://javolution.org/apidocs/javolution/util/function/Equality.html">
+ *       Javolution - Equality</a>
+ * @version 7.0
+ */
+template<typename T, typename Enable = void> struct Equality {
+
+    /** Returns the hash code of the specified object. */
+    static int hashOf(const T& object) {
+        return object.hashCode();
+    }
+
+    /** Indicates if the specified objects are equal. */
+    static bool areEqual(const T& left, const T& right) {
+        return left.equals(right);
+    }
+};
+
+// Primitive types (integral, character and boolean).
+template<typename T> struct Equality<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+
+    static int hashOf(T value) {
+        if (std::is_same<T, bool>::value) // As Boolean.hashCode
+            return value ? 1231 : 1237;
+        Type::int64 bits = (Type::int64) value;
+        return (sizeof(T) > 4) ? (int) (bits ^ (bits >> 32)) : (int) bits;
+    }
+
+    static bool areEqual(T left, T right) {
+        return left == right;
+    }
+};
+
+// Primitive types (floating point).
+template<typename T> struct Equality<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+
+    static int hashOf(T value) {
+        return hashCode(value);
+    }
+
+    static bool areEqual(T left, T right) {
+        return bitsOf(left) == bitsOf(right);
+    }
+
+private:
+    static int hashCode(float value) { // As Float.hashCode (floatToIntBits).
+        float f = (value != value) ? NAN : value; // Canonical NaN.
+        Type::int32 bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    static int hashCode(double value) { // As Double.hashCode (doubleToLongBits).
+        Type::int64 bits = bitsOf(value);
+        return (int) (bits ^ (bits >> 32));
+    }
+
+    static int hashCode(long double value) {
+        return hashCode((double) value);
+    }
+
+    static Type::int64 bitsOf(T value) {
+        double d = (value != value) ? (double) NAN : (double) value; // Canonical NaN.
+        Type::int64 bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return bits;
+    }
+};
+
+}
+}
@@ -0,0 +1,366 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include "java/lang/Object.hpp"
+#include "java/lang/Array.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/StringBuilder.hpp"
+#include "java/util/Equality.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * <p> A hash map with open addressing (Robin Hood hashing) whose keys are hashed and compared through the
+ *     Equality trait (by default the keys <code>hashCode()</code> and <code>equals(...)</code> methods).</p>
+ *
+ * <p> Keys and values are stored inline in a contiguous table (no node allocation and no boxing of primitive or
+ *     value-type keys) along with the hash codes of the keys; most lookups are resolved by comparing hash codes and
+ *     probe distances only. Resizing is incremental: when the table grows, the previous table is kept and its
+ *     entries are moved a few slots at a time by subsequent updates, so no single <code>put</code> pays for a
+ *     full rehash.</p>
+ *
+ * <pre><code>
+ * FastMap<String, Integer> ages = new FastMap<String, Integer>::Value();
+ * ages.put("Alice", 32);
+ * Integer age = ages.get("Alice");
+ * </code></pre>
+ *
+ * <p> Note: Unlike Java maps, absent keys are reported as default-constructed values (null for objects, zero for
+ *           primitives and value types); containsKey should be used when such values can be stored. Null keys
+ *           are not supported.</p>
+ *
+ * @see  <a href="https://docs.oracle.com/javase/8/docs/api/java/util/HashMap.html">Java - HashMap</a>
+ * @version 7.0
+ */
+template<typename K, typename V, typename EQ = Equality<K>> class FastMap final : public Object {
+public:
+    class Value final : public Object::Value {
+        static const unsigned int EMPTY = 0;
+        static const unsigned int REMOVED = 1; // Entry removed or migrated from a previous table.
+        static const int MIN_CAPACITY = 8;
+        static const int MIGRATION_STEP = 8; // Number of slots of the previous table migrated per update.
+
+        struct Entry {
+            K key;
+            V value;
+        };
+
+        /** Open addressing table; the tags hold the mixed hash codes of the keys (EMPTY or REMOVED if none). */
+        struct Table {
+            Array<unsigned int> tagArray;
+            Array<Entry> entryArray;
+            unsigned int* tags; // Contiguous elements of tagArray.
+            Entry* entries; // Contiguous elements of entryArray.
+            int mask; // Capacity minus one (-1 if no table).
+            int shift; // The tags high bits select the home slots.
+
+            Table() :
+                    tags(nullptr), entries(nullptr), mask(-1), shift(32) {
+                tagArray.length = 0; // Null arrays (their handles leave the length uninitialized).
+                entryArray.length = 0;
+            }
+
+            explicit Table(int capacity) :
+                    tagArray(newContiguousArray<unsigned int>(capacity)),
+                    entryArray(newContiguousArray<Entry>(capacity)), mask(capacity - 1), shift(32) {
+                int count;
+                tags = tagArray.template this_<typename Array<unsigned int>::Value>()->segmentAt(0, count);
+                entries = entryArray.template this_<typename Array<Entry>::Value>()->segmentAt(0, count);
+                std::fill(tags, tags + capacity, (unsigned int) EMPTY);
+                for (int n = capacity; n > 1; n >>= 1)
+                    --shift;
+            }
+
+            int capacity() const {
+                return mask + 1;
+            }
+
+            int home(unsigned int tag) const {
+                return (int) (tag >> shift);
+            }
+
+            int distance(int index, unsigned int tag) const {
+                return (index - home(tag)) & mask;
+            }
+        };
+
+        Table table; // The current table.
+        Table old; // The previous table while resizing (no table otherwise).
+        int migrated; // The number of slots of the previous table already migrated.
+        int count; // The number of entries in both tables.
+
+        /** Returns an array whose elements are contiguous (inline for small arrays). */
+        template<typename T> static Array<T> newContiguousArray(int length) {
+            return (length <= Array<T>::SEGMENT_SIZE) ? Array<T>::newInstance(length)
+                    : Array<T>::newFlatInstance(length);
+        }
+
+        static unsigned int tagOf(const K& key) {
+            unsigned int tag = (unsigned int) EQ::hashOf(key) * 0x9E3779B9u; // Fibonacci hashing.
+            return (tag > REMOVED) ? tag : tag + 2;
+        }
+
+        /** Returns the slot of the specified key in the specified table or -1 if not found. */
+        static int find(const Table& t, unsigned int tag, const K& key) {
+            if (t.mask < 0)
+                return -1;
+            for (int i = t.home(tag), dist = 0;; i = (i + 1) & t.mask, ++dist) {
+                unsigned int other = t.tags[i];
+                if (other == EMPTY)
+                    return -1;
+                if (other == REMOVED) // Previous table only (no entry has moved since).
+                    continue;
+                if (t.distance(i, other) < dist) // The key would have taken this slot.
+                    return -1;
+                if ((other == tag) && EQ::areEqual(t.entries[i].key, key))
+                    return i;
+            }
+        }
+
+        /** Inserts the specified entry (not already present) into the current table. */
+        void insert(unsigned int tag, Entry&& entry) {
+            Table& t = table;
+            for (int i = t.home(tag), dist = 0;; i = (i + 1) & t.mask, ++dist) {
+                unsigned int other = t.tags[i];
+                if (other == EMPTY) {
+                    t.tags[i] = tag;
+                    t.entries[i] = std::move(entry);
+                    return;
+                }
+                int otherDist = t.distance(i, other);
+                if (otherDist < dist) { // Takes the slot of the entry closer to its home, which moves on.
+                    std::swap(t.tags[i], tag);
+                    std::swap(t.entries[i], entry);
+                    dist = otherDist;
+                }
+            }
+        }
+
+        /** Removes the entry at the specified slot of the current table (the following entries are shifted
+         *  backward, no tombstone). */
+        void erase(int i) {
+            Table& t = table;
+            for (int next = (i + 1) & t.mask;; i = next, next = (next + 1) & t.mask) {
+                unsigned int tag = t.tags[next];
+                if ((tag == EMPTY) || (t.distance(next, tag) == 0))
+                    break;
+                t.tags[i] = tag;
+                t.entries[i] = std::move(t.entries[next]);
+            }
+            t.tags[i] = EMPTY;
+            t.entries[i] = Entry(); // Releases the key and value (if any).
+        }
+
+        /** Removes the entry at the specified slot of the previous table. */
+        void eraseOld(int i) {
+            old.tags[i] = REMOVED;
+            old.entries[i] = Entry();
+        }
+
+        /** Moves up to the specified number of slots from the previous table to the current one. */
+        void migrate(int slots) {
+            for (; (slots > 0) && (old.mask >= 0); --slots) {
+                unsigned int tag = old.tags[migrated];
+                if (tag > REMOVED) {
+                    insert(tag, std::move(old.entries[migrated]));
+                    eraseOld(migrated);
+                }
+                if (++migrated > old.mask)
+                    old = Table(); // Done.
+            }
+        }
+
+        /** Doubles the capacity of the current table, the entries are migrated incrementally. */
+        void grow() {
+            if (old.mask >= 0)
+                migrate(old.capacity()); // Completes the previous resize.
+            int capacity = table.capacity();
+            if (capacity == 0) {
+                table = Table(MIN_CAPACITY);
+                return;
+            }
+            old = std::move(table);
+            table = Table(capacity << 1);
+            migrated = 0;
+        }
+
+    public:
+
+        /** Creates an empty map (no table allocated until the first insertion). */
+        Value() :
+                migrated(0), count(0) {
+        }
+
+        int size() const {
+            return count;
+        }
+
+        /** Returns the value for the specified key or nullptr if the key is not present. */
+        const V* lookup(const K& key) const {
+            unsigned int tag = tagOf(key);
+            int i = find(table, tag, key);
+            if (i >= 0)
+                return &table.entries[i].value;
+            i = find(old, tag, key);
+            return (i >= 0) ? &old.entries[i].value : nullptr;
+        }
+
+        V put(const K& key, const V& value) {
+            migrate(MIGRATION_STEP);
+            unsigned int tag = tagOf(key);
+            int i = find(table, tag, key);
+            if (i >= 0) {
+                V previous = std::move(table.entries[i].value);
+                table.entries[i].value = value;
+                return previous;
+            }
+            i = find(old, tag, key);
+            if (i >= 0) { // Not migrated yet, moves it now.
+                Entry entry { std::move(old.entries[i].key), value };
+                V previous = std::move(old.entries[i].value);
+                eraseOld(i);
+                insert(tag, std::move(entry));
+                return previous;
+            }
+            int capacity = table.capacity();
+            if (count >= capacity - (capacity >> 2)) // Load factor 0.75
+                grow();
+            insert(tag, Entry { key, value });
+            ++count;
+            return V();
+        }
+
+        V remove(const K& key) {
+            migrate(MIGRATION_STEP);
+            unsigned int tag = tagOf(key);
+            int i = find(table, tag, key);
+            if (i >= 0) {
+                V previous = std::move(table.entries[i].value);
+                erase(i);
+                --count;
+                return previous;
+            }
+            i = find(old, tag, key);
+            if (i >= 0) {
+                V previous = std::move(old.entries[i].value);
+                eraseOld(i);
+                --count;
+                return previous;
+            }
+            return V();
+        }
+
+        void clear() {
+            table = Table();
+            old = Table();
+            migrated = 0;
+            count = 0;
+        }
+
+        /** Performs an action for each entry of this map (unspecified order). */
+        template<class Action> void forEach(Action action) const {
+            for (int i = 0; i <= old.mask; ++i) {
+                if (old.tags[i] > REMOVED)
+                    action(old.entries[i].key, old.entries[i].value);
+            }
+            for (int i = 0; i <= table.mask; ++i) {
+                if (table.tags[i] > REMOVED)
+                    action(table.entries[i].key, table.entries[i].value);
+            }
+        }
+
+        String toString() const override {
+            StringBuilder sb = new StringBuilder::Value();
+            sb.append('{');
+            bool first = true;
+            forEach([&](const K& key, const V& value) {
+                if (!first)
+                    sb.append(", ");
+                first = false;
+                sb.append(String::valueOf(key)).append('=').append(String::valueOf(value));
+            });
+            return sb.append('}').toString();
+        }
+
+    };
+
+    CLASS(FastMap)
+
+    /**
+     * Returns the number of entries in this map.
+     */
+    int size() const {
+        return this_<Value>()->size();
+    }
+
+    /**
+     * Indicates if this map is empty.
+     */
+    bool isEmpty() const {
+        return this_<Value>()->size() == 0;
+    }
+
+    /**
+     * Indicates if this map contains the specified key.
+     */
+    bool containsKey(const K& key) const {
+        return this_<Value>()->lookup(key) != nullptr;
+    }
+
+    /**
+     * Returns the value associated to the specified key or a default-constructed value (e.g. null) if none.
+     */
+    V get(const K& key) const {
+        const V* value = this_<Value>()->lookup(key);
+        return (value != nullptr) ? *value : V();
+    }
+
+    /**
+     * Returns the value associated to the specified key or the specified default value if none.
+     */
+    V getOrDefault(const K& key, const V& defaultValue) const {
+        const V* value = this_<Value>()->lookup(key);
+        return (value != nullptr) ? *value : defaultValue;
+    }
+
+    /**
+     * Associates the specified value to the specified key and returns the previous value (or a default-constructed
+     * value if none).
+     */
+    V put(const K& key, const V& value) {
+        return this_<Value>()->put(key, value);
+    }
+
+    /**
+     * Removes the entry for the specified key and returns its value (or a default-constructed value if none).
+     */
+    V remove(const K& key) {
+        return this_<Value>()->remove(key);
+    }
+
+    /**
+     * Removes all the entries of this map (the table is released).
+     */
+    void clear() {
+        this_<Value>()->clear();
+    }
+
+    /**
+     * Performs an action for each entry of this map (unspecified order).
+     * For example: <code>ages.forEach([](const String& name, const Integer& age) { ... })</code>
+     */
+    template<class Action> void forEach(Action action) const {
+        this_<Value>()->forEach(action);
+    }
+
+};
+
+}
+}
@@ -0,0 +1,434 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include "java/lang/Object.hpp"
+#include "java/lang/Array.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/StringBuilder.hpp"
+#include "java/lang/IndexOutOfBoundsException.hpp"
+#include "java/util/NoSuchElementException.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * <p> A random access list of elements with amortized constant time insertions and deletions at both ends
+ *     (it can be used as a list, a stack, a queue or a deque).</p>
+ *
+ * <p> The elements are held in a circular buffer backed by a fractal Array (FastHeap blocks). Growing the table
+ *     never copies the whole buffer: when the table is not wrapped around (e.g. only appended to), the buffer
+ *     capacity is increased by one segment at a time (worst-case append in O(log n), no copy); otherwise its
+ *     capacity is doubled and only the smaller part of the wrapped elements is moved. Insertions and deletions in
+ *     the middle of the table shift the elements on the shorter side, segment by segment.</p>
+ *
+ * <pre><code>
+ * FastTable<String> names = new FastTable<String>::Value();
+ * names.add("Bob");
+ * names.addFirst("Alice");
+ * names.add(1, "Carol"); // [Alice, Carol, Bob]
+ * </code></pre>
+ *
+ * <p> Note: This class is derived from org.javolution.util.FastTable but optimized for C++. As for
+ *           <code>std::vector</code>, references to elements are invalidated by insertions and deletions; once
+ *           the capacity exceeds one segment, appending to a table which is not wrapped around does not move
+ *           its elements.</p>
+ *
+ * @see  <a href="https://docs.oracle.com/javase/8/docs/api/java/util/ArrayDeque.html">Java - ArrayDeque</a>
+ * @version 7.0
+ */
+template<typename E> class FastTable final : public Object {
+public:
+    class Value final : public Object::Value {
+        typedef typename Array<E>::Value ArrayValue;
+        static const int SEGMENT_SIZE = Array<E>::SEGMENT_SIZE;
+        static const int SEGMENT_MASK = SEGMENT_SIZE - 1;
+        static const int MIN_CAPACITY = 8;
+
+        Array<E> elements; // Circular buffer (null until the first insertion).
+        int capacity; // Power of two up to SEGMENT_SIZE, multiple of SEGMENT_SIZE above.
+        int head; // Buffer index of the first element.
+        int count; // The number of elements.
+
+        /** Returns the buffer index of the element at the specified index. */
+        int slot(int index) const {
+            int i = head + index;
+            return (i >= capacity) ? i - capacity : i;
+        }
+
+        E& at(int index) {
+            return elements.template this_<ArrayValue>()->elementAt(slot(index));
+        }
+
+        const E& at(int index) const {
+            return elements.template this_<ArrayValue>()->elementAt(slot(index));
+        }
+
+        void checkIndex(int index) const {
+            if ((index < 0) || (index >= count))
+                throw IndexOutOfBoundsException(
+                        "index: " + String::valueOf(index) + ", size: " + String::valueOf(count));
+        }
+
+        void checkNotEmpty() const {
+            if (count == 0)
+                throw NoSuchElementException("Empty table");
+        }
+
+        /** Increases the capacity of a full table. */
+        void grow() {
+            if (capacity == 0) {
+                capacity = std::min((int) MIN_CAPACITY, (int) SEGMENT_SIZE);
+                elements = Array<E>::newInstance(capacity);
+                return;
+            }
+            if (head == 0) { // Not wrapped, adds one segment (no element moved).
+                capacity = (capacity < SEGMENT_SIZE) ? capacity << 1 : capacity + SEGMENT_SIZE;
+                elements.setLength(capacity);
+                return;
+            }
+            int oldCapacity = capacity; // Wrapped, doubles the capacity and moves the smaller part.
+            capacity <<= 1;
+            elements.setLength(capacity);
+            int wrapped = head + count - oldCapacity;
+            if (wrapped <= oldCapacity - head) {
+                move(0, oldCapacity, wrapped);
+            } else {
+                move(head, head + oldCapacity, oldCapacity - head);
+                head += oldCapacity;
+            }
+        }
+
+        /** Moves elements between non-overlapping buffer ranges (not wrapped). */
+        void move(int src, int dst, int n) {
+            ArrayValue* array = elements.template this_<ArrayValue>();
+            while (n > 0) {
+                int srcCount, dstCount;
+                E* srcSegment = array->segmentAt(src, srcCount);
+                E* dstSegment = array->segmentAt(dst, dstCount);
+                int k = std::min(std::min(srcCount, dstCount), n);
+                std::move(srcSegment, srcSegment + k, dstSegment);
+                src += k;
+                dst += k;
+                n -= k;
+            }
+        }
+
+        /** Shifts the elements in the range [from, to[ one position toward the tail (the element at 'to' is
+         *  overwritten). */
+        void shiftTowardTail(int from, int to) {
+            ArrayValue* array = elements.template this_<ArrayValue>();
+            for (int end = to; end > from;) {
+                int src = slot(end - 1); // Moves backward the contiguous elements ending at src/dst.
+                int dst = (src + 1 == capacity) ? 0 : src + 1;
+                int n = std::min(std::min((src & SEGMENT_MASK) + 1, (dst & SEGMENT_MASK) + 1), end - from);
+                int count;
+                E* srcSegment = array->segmentAt(src - n + 1, count);
+                E* dstSegment = array->segmentAt(dst - n + 1, count);
+                std::move_backward(srcSegment, srcSegment + n, dstSegment + n);
+                end -= n;
+            }
+        }
+
+        /** Shifts the elements in the range [from, to[ one position toward the head (the element at 'from - 1' is
+         *  overwritten). */
+        void shiftTowardHead(int from, int to) {
+            ArrayValue* array = elements.template this_<ArrayValue>();
+            for (int begin = from; begin < to;) {
+                int src = slot(begin); // Moves forward the contiguous elements starting at src/dst.
+                int dst = (src == 0) ? capacity - 1 : src - 1;
+                int n = std::min(std::min(SEGMENT_SIZE - (src & SEGMENT_MASK), SEGMENT_SIZE - (dst & SEGMENT_MASK)),
+                        std::min(std::min(capacity - src, capacity - dst), to - begin));
+                int count;
+                E* srcSegment = array->segmentAt(src, count);
+                E* dstSegment = array->segmentAt(dst, count);
+                std::move(srcSegment, srcSegment + n, dstSegment);
+                begin += n;
+            }
+        }
+
+    public:
+
+        /** Creates an empty table (no buffer allocated until the first insertion). */
+        Value() :
+                capacity(0), head(0), count(0) {
+        }
+
+        int size() const {
+            return count;
+        }
+
+        const E& get(int index) const {
+            checkIndex(index);
+            return at(index);
+        }
+
+        E& get(int index) {
+            checkIndex(index);
+            return at(index);
+        }
+
+        // The elements are passed by value since they may alias elements of this table.
+
+        E set(int index, E element) {
+            checkIndex(index);
+            std::swap(element, at(index));
+            return element;
+        }
+
+        void addFirst(E element) {
+            if (count == capacity)
+                grow();
+            head = (head == 0) ? capacity - 1 : head - 1;
+            at(0) = std::move(element);
+            ++count;
+        }
+
+        void addLast(E element) {
+            if (count == capacity)
+                grow();
+            at(count++) = std::move(element);
+        }
+
+        void add(int index, E element) {
+            if ((index < 0) || (index > count))
+                throw IndexOutOfBoundsException(
+                        "index: " + String::valueOf(index) + ", size: " + String::valueOf(count));
+            if (count == capacity)
+                grow();
+            if (index < count - index) { // Shifts the elements before.
+                head = (head == 0) ? capacity - 1 : head - 1;
+                shiftTowardHead(1, index + 1);
+            } else { // Shifts the elements after.
+                shiftTowardTail(index, count);
+            }
+            at(index) = std::move(element);
+            ++count;
+        }
+
+        E removeFirst() {
+            checkNotEmpty();
+            E element = std::move(at(0));
+            at(0) = E(); // Releases the element (if any).
+            head = (head + 1 == capacity) ? 0 : head + 1;
+            --count;
+            return element;
+        }
+
+        E removeLast() {
+            checkNotEmpty();
+            E element = std::move(at(--count));
+            at(count) = E();
+            return element;
+        }
+
+        E remove(int index) {
+            checkIndex(index);
+            E element = std::move(at(index));
+            if (index < count - 1 - index) { // Shifts the elements before.
+                shiftTowardTail(0, index);
+                at(0) = E();
+                head = (head + 1 == capacity) ? 0 : head + 1;
+            } else { // Shifts the elements after.
+                shiftTowardHead(index + 1, count);
+                at(count - 1) = E();
+            }
+            --count;
+            return element;
+        }
+
+        void clear() {
+            for (int i = 0; i < count; ++i)
+                at(i) = E();
+            head = 0;
+            count = 0;
+        }
+
+        /** Performs an action for each element of this table (in order). */
+        template<class Action> void forEach(Action action) const {
+            if (count == 0) // No buffer allocated yet.
+                return;
+            const ArrayValue* array = elements.template this_<ArrayValue>();
+            for (int i = 0; i < count;) {
+                int segmentCount;
+                int start = slot(i);
+                const E* segment = array->segmentAt(start, segmentCount);
+                int n = std::min(std::min(segmentCount, capacity - start), count - i);
+                for (int j = 0; j < n; ++j)
+                    action(segment[j]);
+                i += n;
+            }
+        }
+
+        String toString() const override {
+            StringBuilder sb = new StringBuilder::Value();
+            sb.append('[');
+            for (int i = 0; i < count; ++i) {
+                if (i != 0)
+                    sb.append(", ");
+                sb.append(String::valueOf(at(i)));
+            }
+            return sb.append(']').toString();
+        }
+
+    };
+
+    CLASS(FastTable)
+
+    /**
+     * Returns the number of elements in this table.
+     */
+    int size() const {
+        return this_<Value>()->size();
+    }
+
+    /**
+     * Indicates if this table is empty.
+     */
+    bool isEmpty() const {
+        return this_<Value>()->size() == 0;
+    }
+
+    /**
+     * Returns the element at the specified index.
+     *
+     * @throws IndexOutOfBoundsException if <code>(index < 0) || (index >= size())</code>
+     */
+    const E& get(int index) const {
+        return this_<Value>()->get(index);
+    }
+
+    /**
+     * Replaces the element at the specified index and returns the previous element.
+     *
+     * @throws IndexOutOfBoundsException if <code>(index < 0) || (index >= size())</code>
+     */
+    E set(int index, const E& element) {
+        return this_<Value>()->set(index, element);
+    }
+
+    /**
+     * Returns the element at the specified index (which can be modified in place).
+     *
+     * @throws IndexOutOfBoundsException if <code>(index < 0) || (index >= size())</code>
+     */
+    E& operator[](int index) {
+        return this_<Value>()->get(index);
+    }
+
+    // const version.
+    const E& operator[](int index) const {
+        return this_<Value>()->get(index);
+    }
+
+    /**
+     * Appends the specified element to the end of this table (amortized constant time).
+     */
+    void add(const E& element) {
+        this_<Value>()->addLast(element);
+    }
+
+    /**
+     * Inserts the specified element at the specified index; the elements on the shorter side are shifted.
+     *
+     * @throws IndexOutOfBoundsException if <code>(index < 0) || (index > size())</code>
+     */
+    void add(int index, const E& element) {
+        this_<Value>()->add(index, element);
+    }
+
+    /**
+     * Inserts the specified element at the front of this table (amortized constant time).
+     */
+    void addFirst(const E& element) {
+        this_<Value>()->addFirst(element);
+    }
+
+    /**
+     * Appends the specified element to the end of this table (amortized constant time).
+     */
+    void addLast(const E& element) {
+        this_<Value>()->addLast(element);
+    }
+
+    /**
+     * Moves the specified element to the end of this table (amortized constant time).
+     */
+    void addLast(E&& element) {
+        this_<Value>()->addLast(std::move(element));
+    }
+
+    /**
+     * Returns the first element of this table.
+     *
+     * @throws NoSuchElementException if this table is empty.
+     */
+    const E& getFirst() const {
+        if (isEmpty())
+            throw NoSuchElementException("Empty table");
+        return get(0);
+    }
+
+    /**
+     * Returns the last element of this table.
+     *
+     * @throws NoSuchElementException if this table is empty.
+     */
+    const E& getLast() const {
+        if (isEmpty())
+            throw NoSuchElementException("Empty table");
+        return get(size() - 1);
+    }
+
+    /**
+     * Removes and returns the element at the specified index; the elements on the shorter side are shifted.
+     *
+     * @throws IndexOutOfBoundsException if <code>(index < 0) || (index >= size())</code>
+     */
+    E remove(int index) {
+        return this_<Value>()->remove(index);
+    }
+
+    /**
+     * Removes and returns the first element of this table (constant time).
+     *
+     * @throws NoSuchElementException if this table is empty.
+     */
+    E removeFirst() {
+        return this_<Value>()->removeFirst();
+    }
+
+    /**
+     * Removes and returns the last element of this table (constant time).
+     *
+     * @throws NoSuchElementException if this table is empty.
+     */
+    E removeLast() {
+        return this_<Value>()->removeLast();
+    }
+
+    /**
+     * Removes all the elements of this table (the capacity is kept).
+     */
+    void clear() {
+        this_<Value>()->clear();
+    }
+
+    /**
+     * Performs an action for each element of this table, in order (no bounds checks or virtual calls per element).
+     * For example: <code>names.forEach([](const String& name) { System::out.println(name);})</code>
+     */
+    template<class Action> void forEach(Action action) const {
+        this_<Value>()->forEach(action);
+    }
+
+};
+
+}
+}
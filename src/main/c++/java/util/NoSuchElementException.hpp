@@ -0,0 +1,31 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include "java/lang/RuntimeException.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * Thrown to indicate that there are no more elements in a collection (e.g. removing the first element of an empty
+ * table).
+ *
+ * @see  <a href="https://docs.oracle.com/javase/8/docs/api/java/util/NoSuchElementException.html">
+ *       Java - NoSuchElementException</a>
+ * @version 7.0
+ */
+class NoSuchElementException: public RuntimeException {
+public:
+
+    /** Creates a no such element exception with the specified optional message.*/
+    NoSuchElementException(const String& message = nullptr) :
+            RuntimeException(message) {
+    }
+};
+
+}
+}
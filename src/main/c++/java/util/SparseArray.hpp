@@ -0,0 +1,526 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include "java/lang/Object.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/StringBuilder.hpp"
+#include "java/util/NoSuchElementException.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * <p> A sparse array of elements indexed by unsigned integers (32 or 64 bits), ordered by index.</p>
+ *
+ * <p> The array is a 16-way radix trie (the same fanout as the fractal Array blocks) in which only the populated
+ *     nodes are allocated; inner nodes having a single child are skipped (path compression), so that the depth of
+ *     the trie depends on the number of elements and their spread, not on the width of the indices. Nodes are
+ *     allocated on the FastHeap (inner nodes are exactly one default block).</p>
+ *
+ * <pre><code>
+ * SparseArray<Order, std::uint64_t> orders = new SparseArray<Order, std::uint64_t>::Value();
+ * orders.set(orderId, order);
+ * std::uint64_t next;
+ * if (orders.ceilingIndex(orderId + 1, next)) { ... }
+ * orders.removeRange(0, lastFilledId); // Removes the orders up to lastFilledId (inclusive).
+ * </code></pre>
+ *
+ * <p> Note: Unlike Java maps, absent indices are reported as default-constructed elements (null for objects,
+ *           zero for primitives and value types).</p>
+ *
+ * @see  <a href="http://javolution.org/apidocs/javolution/util/SparseArray.html">Javolution - SparseArray</a>
+ * @version 7.0
+ */
+template<typename E, typename Index = unsigned int> class SparseArray final : public Object {
+    static_assert(std::is_unsigned<Index>::value && (sizeof(Index) >= sizeof(unsigned int)),
+            "Indices must be unsigned integers of at least 32 bits"); // Narrower types are promoted to int.
+public:
+    class Value final : public Object::Value {
+        static const int BITS = sizeof(Index) * 8;
+        static const int DIGIT_BITS = 4; // 16-way.
+        static const int DIGIT_MASK = (1 << DIGIT_BITS) - 1;
+
+        struct Node {
+            Index prefix; // The index of a leaf, the high bits common to all indices of an inner node.
+            int shift; // The position of the digit selecting the children (negative for leaves).
+
+            Node(Index prefix, int shift) :
+                    prefix(prefix), shift(shift) {
+            }
+
+            bool isLeaf() const {
+                return shift < 0;
+            }
+
+            void* operator new(size_t size) {
+                return FastHeap::allocate(size);
+            }
+
+            void operator delete(void* mem) {
+                FastHeap::deallocate(mem);
+            }
+        };
+
+        struct Leaf final : Node {
+            E element;
+
+            Leaf(Index index, const E& element) :
+                    Node(index, -1), element(element) {
+            }
+        };
+
+        struct Inner final : Node {
+            int size; // The number of elements in this subtree (at least two).
+            Node* children[DIGIT_MASK + 1];
+
+            Inner(Index index, int shift) :
+                    Node(index & highMask(shift), shift), size(0), children() {
+            }
+
+            void add(Node* child) {
+                children[digit(child->prefix, this->shift)] = child;
+                size += sizeOf(child);
+            }
+
+            /** Indicates if the specified index may be held by this node. */
+            bool covers(Index index) const {
+                return ((index ^ this->prefix) & highMask(this->shift)) == 0;
+            }
+
+            Index lowest() const {
+                return this->prefix;
+            }
+
+            Index highest() const {
+                return this->prefix | ~highMask(this->shift);
+            }
+        };
+
+        Node* root;
+        int length; // The number of elements.
+
+        /** Returns the mask of the index bits above the digit at the specified shift. */
+        static Index highMask(int shift) {
+            return (shift + DIGIT_BITS >= BITS) ? Index(0) : (Index) (~Index(0) << (shift + DIGIT_BITS));
+        }
+
+        static int digit(Index index, int shift) {
+            return (int) (index >> shift) & DIGIT_MASK;
+        }
+
+        /** Returns the shift of the highest digit set in the specified (non-zero) value. */
+        static int highestDigit(Index diff) {
+            int shift = 0;
+            while ((diff >> shift) > (Index) DIGIT_MASK)
+                shift += DIGIT_BITS;
+            return shift;
+        }
+
+        static Leaf* leaf(Node* node) {
+            return static_cast<Leaf*>(node);
+        }
+
+        static Inner* inner(Node* node) {
+            return static_cast<Inner*>(node);
+        }
+
+        /** Returns the number of elements in the specified subtree. */
+        static int sizeOf(const Node* node) {
+            return node->isLeaf() ? 1 : static_cast<const Inner*>(node)->size;
+        }
+
+        static void destroy(Node* node) {
+            if (node->isLeaf()) {
+                delete leaf(node);
+                return;
+            }
+            Inner* in = inner(node);
+            for (Node* child : in->children) {
+                if (child != nullptr)
+                    destroy(child);
+            }
+            delete in;
+        }
+
+        /** Returns the slot holding the leaf of the specified index or the slot where the leaf should be inserted
+         *  (the parent slot is set to the slot of the inner node holding the slot returned, if any). */
+        Node** slotOf(Index index, Node**& parent) {
+            parent = nullptr;
+            Node** slot = &root;
+            while ((*slot != nullptr) && !(*slot)->isLeaf() && inner(*slot)->covers(index)) {
+                parent = slot;
+                slot = &inner(*slot)->children[digit(index, (*slot)->shift)];
+            }
+            return slot;
+        }
+
+        /** Adds the specified delta to the sizes of the inner nodes from the root down to the specified slot (on
+         *  the path of the specified index). */
+        void resize(Node** slot, Index index, int delta) {
+            for (Node** s = &root; s != slot; s = &inner(*s)->children[digit(index, (*s)->shift)])
+                inner(*s)->size += delta;
+        }
+
+        /** Replaces an inner node having less than two children by its remaining child (if any). */
+        static void collapse(Node** slot) {
+            Inner* in = inner(*slot);
+            int count = 0;
+            Node* remaining = nullptr;
+            for (Node* child : in->children) {
+                if (child != nullptr) {
+                    remaining = child;
+                    ++count;
+                }
+            }
+            if (count >= 2)
+                return;
+            *slot = remaining;
+            delete in;
+        }
+
+        static Leaf* first(Node* node) {
+            while (!node->isLeaf()) {
+                Node* const* child = inner(node)->children;
+                while (*child == nullptr)
+                    ++child;
+                node = *child;
+            }
+            return leaf(node);
+        }
+
+        static Leaf* last(Node* node) {
+            while (!node->isLeaf()) {
+                Node* const* child = inner(node)->children + DIGIT_MASK;
+                while (*child == nullptr)
+                    --child;
+                node = *child;
+            }
+            return leaf(node);
+        }
+
+        /** Returns the leaf with the smallest index greater than or equal to the specified index (or nullptr). */
+        static Leaf* ceiling(Node* node, Index index) {
+            if (node->isLeaf())
+                return (node->prefix >= index) ? leaf(node) : nullptr;
+            Inner* in = inner(node);
+            if (in->highest() < index)
+                return nullptr;
+            if (in->lowest() > index)
+                return first(in);
+            int d = digit(index, in->shift);
+            if (in->children[d] != nullptr) {
+                Leaf* found = ceiling(in->children[d], index);
+                if (found != nullptr)
+                    return found;
+            }
+            while (++d <= DIGIT_MASK) {
+                if (in->children[d] != nullptr)
+                    return first(in->children[d]);
+            }
+            return nullptr;
+        }
+
+        /** Returns the leaf with the greatest index less than or equal to the specified index (or nullptr). */
+        static Leaf* floor(Node* node, Index index) {
+            if (node->isLeaf())
+                return (node->prefix <= index) ? leaf(node) : nullptr;
+            Inner* in = inner(node);
+            if (in->lowest() > index)
+                return nullptr;
+            if (in->highest() < index)
+                return last(in);
+            int d = digit(index, in->shift);
+            if (in->children[d] != nullptr) {
+                Leaf* found = floor(in->children[d], index);
+                if (found != nullptr)
+                    return found;
+            }
+            while (--d >= 0) {
+                if (in->children[d] != nullptr)
+                    return last(in->children[d]);
+            }
+            return nullptr;
+        }
+
+        /** Removes the elements in the specified range from the subtree at the specified slot; returns the number
+         *  of elements removed. */
+        static int removeRange(Node** slot, Index first, Index last) {
+            Node* node = *slot;
+            if (node->isLeaf()) {
+                if ((node->prefix < first) || (node->prefix > last))
+                    return 0;
+                delete leaf(node);
+                *slot = nullptr;
+                return 1;
+            }
+            Inner* in = inner(node);
+            if ((in->highest() < first) || (in->lowest() > last))
+                return 0;
+            if ((in->lowest() >= first) && (in->highest() <= last)) { // Whole subtree (not searched).
+                int removed = in->size;
+                destroy(in);
+                *slot = nullptr;
+                return removed;
+            }
+            int removed = 0;
+            for (Node*& child : in->children) {
+                if (child != nullptr)
+                    removed += removeRange(&child, first, last);
+            }
+            in->size -= removed;
+            if (removed != 0)
+                collapse(slot);
+            return removed;
+        }
+
+        template<class Action> static void forEach(const Node* node, Action& action) {
+            if (node->isLeaf()) {
+                action(node->prefix, static_cast<const Leaf*>(node)->element);
+                return;
+            }
+            for (const Node* child : static_cast<const Inner*>(node)->children) {
+                if (child != nullptr)
+                    forEach(child, action);
+            }
+        }
+
+    public:
+
+        Value() :
+                root(nullptr), length(0) {
+        }
+
+        ~Value() {
+            if (root != nullptr)
+                destroy(root);
+        }
+
+        int size() const {
+            return length;
+        }
+
+        /** Returns the element at the specified index or nullptr if none. */
+        const E* lookup(Index index) const {
+            const Node* node = root;
+            while ((node != nullptr) && !node->isLeaf()) {
+                const Inner* in = static_cast<const Inner*>(node);
+                if (!in->covers(index))
+                    return nullptr;
+                node = in->children[digit(index, in->shift)];
+            }
+            return ((node != nullptr) && (node->prefix == index)) ? &static_cast<const Leaf*>(node)->element
+                    : nullptr;
+        }
+
+        E set(Index index, const E& element) {
+            Node** parent;
+            Node** slot = slotOf(index, parent);
+            Node* node = *slot;
+            if (node == nullptr) {
+                *slot = new Leaf(index, element);
+            } else if (node->isLeaf() && (node->prefix == index)) {
+                E previous = leaf(node)->element;
+                leaf(node)->element = element;
+                return previous;
+            } else { // Splits at the highest digit differing from the node prefix.
+                Index diff = (index ^ node->prefix) & highMask(node->isLeaf() ? -DIGIT_BITS : node->shift);
+                Inner* in = new Inner(index, highestDigit(diff));
+                in->add(node);
+                in->add(new Leaf(index, element));
+                *slot = in;
+            }
+            resize(slot, index, 1);
+            ++length;
+            return E();
+        }
+
+        E remove(Index index) {
+            Node** parent;
+            Node** slot = slotOf(index, parent);
+            Node* node = *slot;
+            if ((node == nullptr) || !node->isLeaf() || (node->prefix != index))
+                return E();
+            E previous = leaf(node)->element;
+            resize(slot, index, -1);
+            delete leaf(node);
+            *slot = nullptr;
+            if (parent != nullptr)
+                collapse(parent);
+            --length;
+            return previous;
+        }
+
+        int removeRange(Index first, Index last) {
+            if ((root == nullptr) || (first > last))
+                return 0;
+            int removed = removeRange(&root, first, last);
+            length -= removed;
+            return removed;
+        }
+
+        void clear() {
+            if (root != nullptr)
+                destroy(root);
+            root = nullptr;
+            length = 0;
+        }
+
+        Index firstIndex() const {
+            if (root == nullptr)
+                throw NoSuchElementException("Empty array");
+            return first(root)->prefix;
+        }
+
+        Index lastIndex() const {
+            if (root == nullptr)
+                throw NoSuchElementException("Empty array");
+            return last(root)->prefix;
+        }
+
+        bool ceilingIndex(Index index, Index& result) const {
+            Leaf* found = (root != nullptr) ? ceiling(root, index) : nullptr;
+            if (found != nullptr)
+                result = found->prefix;
+            return found != nullptr;
+        }
+
+        bool floorIndex(Index index, Index& result) const {
+            Leaf* found = (root != nullptr) ? floor(root, index) : nullptr;
+            if (found != nullptr)
+                result = found->prefix;
+            return found != nullptr;
+        }
+
+        template<class Action> void forEach(Action& action) const {
+            if (root != nullptr)
+                forEach(root, action);
+        }
+
+        String toString() const override {
+            StringBuilder sb = new StringBuilder::Value();
+            sb.append('{');
+            bool first = true;
+            auto append = [&](Index index, const E& element) {
+                if (!first)
+                    sb.append(", ");
+                first = false;
+                sb.append(String::valueOf(std::to_string(index))).append('=').append(String::valueOf(element));
+            };
+            forEach(append);
+            return sb.append('}').toString();
+        }
+
+    };
+
+    CLASS(SparseArray)
+
+    /**
+     * Returns the number of elements in this array.
+     */
+    int size() const {
+        return this_<Value>()->size();
+    }
+
+    /**
+     * Indicates if this array is empty.
+     */
+    bool isEmpty() const {
+        return this_<Value>()->size() == 0;
+    }
+
+    /**
+     * Indicates if this array has an element at the specified index.
+     */
+    bool contains(Index index) const {
+        return this_<Value>()->lookup(index) != nullptr;
+    }
+
+    /**
+     * Returns the element at the specified index or a default-constructed element (e.g. null) if none.
+     */
+    E get(Index index) const {
+        const E* element = this_<Value>()->lookup(index);
+        return (element != nullptr) ? *element : E();
+    }
+
+    /**
+     * Sets the element at the specified index and returns the previous element (or a default-constructed element
+     * if none).
+     */
+    E set(Index index, const E& element) {
+        return this_<Value>()->set(index, element);
+    }
+
+    /**
+     * Removes the element at the specified index and returns it (or a default-constructed element if none).
+     */
+    E remove(Index index) {
+        return this_<Value>()->remove(index);
+    }
+
+    /**
+     * Removes the elements whose indices are in the specified range (inclusive); the subtrees entirely in range
+     * are released without being searched (their sizes are maintained), the time is proportional to the number
+     * of nodes released plus the depth of the range bounds. Returns the number of elements removed.
+     */
+    int removeRange(Index first, Index last) {
+        return this_<Value>()->removeRange(first, last);
+    }
+
+    /**
+     * Removes all the elements of this array.
+     */
+    void clear() {
+        this_<Value>()->clear();
+    }
+
+    /**
+     * Returns the smallest index of this array.
+     *
+     * @throw NoSuchElementException if this array is empty.
+     */
+    Index firstIndex() const {
+        return this_<Value>()->firstIndex();
+    }
+
+    /**
+     * Returns the greatest index of this array.
+     *
+     * @throw NoSuchElementException if this array is empty.
+     */
+    Index lastIndex() const {
+        return this_<Value>()->lastIndex();
+    }
+
+    /**
+     * Searches the smallest index greater than or equal to the specified index; returns false if there is none.
+     */
+    bool ceilingIndex(Index index, Index& result) const {
+        return this_<Value>()->ceilingIndex(index, result);
+    }
+
+    /**
+     * Searches the greatest index less than or equal to the specified index; returns false if there is none.
+     */
+    bool floorIndex(Index index, Index& result) const {
+        return this_<Value>()->floorIndex(index, result);
+    }
+
+    /**
+     * Performs an action for each element of this array in ascending index order.
+     * For example: <code>orders.forEach([](std::uint64_t id, const Order& order) { ... })</code>
+     */
+    template<class Action> void forEach(Action action) const {
+        this_<Value>()->forEach(action);
+    }
+
+};
+
+}
+}
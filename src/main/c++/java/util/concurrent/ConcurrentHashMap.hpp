@@ -0,0 +1,672 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "java/lang/Object.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/StringBuilder.hpp"
+#include "java/util/Equality.hpp"
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * <p> A hash map supporting full concurrency of retrievals and high expected concurrency for updates.</p>
+ *
+ * <p> Retrievals never lock: readers only announce themselves in a per-thread stripe (no shared cache line is
+ *     written) and traverse immutable nodes; updates lock the bin of their key only (the lock is a bit of the bin
+ *     head pointer). A value is updated by replacing its node, so readers always copy a complete entry; the
+ *     returned handles hold their own reference to the values. Unlinked nodes are deleted once no reader can
+ *     access them anymore (grace period).</p>
+ *
+ * <p> When the table needs to grow, the threads updating the map cooperatively transfer the bins of the table
+ *     (a stride of bins at a time) to a table twice as large; retrievals and updates proceed concurrently
+ *     with the transfer.</p>
+ *
+ * <pre><code>
+ * ConcurrentHashMap<String, Integer> cache = new ConcurrentHashMap<String, Integer>::Value();
+ * Integer length = cache.computeIfAbsent(name, [](const String& key) { return Integer::valueOf(key.length()); });
+ * </code></pre>
+ *
+ * <p> Note: Unlike Java maps, absent keys are reported as default-constructed values (null for objects, zero for
+ *           primitives and value types). The key hash codes and equalities are provided by the Equality trait
+ *           (template parameter). Nodes are allocated on the FastHeap.</p>
+ *
+ * @see  <a href="https://docs.oracle.com/javase/8/docs/api/java/util/concurrent/ConcurrentHashMap.html">
+ *       Java - ConcurrentHashMap</a>
+ * @version 7.0
+ */
+template<typename K, typename V, typename EQ = Equality<K>> class ConcurrentHashMap final : public Object {
+public:
+    class Value final : public Object::Value {
+        static const int STRIPES = FastHeap::MAX_CPU; // Per-thread data (readers and counts).
+        static const int MIN_CAPACITY = 16;
+        static const int MAX_CAPACITY = 1 << 30;
+        static const int TRANSFER_STRIDE = 16; // Number of bins transferred at a time.
+        static const int RECLAIM_THRESHOLD = 128; // Number of objects unlinked before waiting for a grace period.
+        static const int SPINS = 64; // Number of active spins before yielding.
+        static const std::uintptr_t LOCKED = 1; // The bin lock bit.
+        static const std::uintptr_t MOVED = 2; // The bin has been transferred to the next table.
+
+        /** An object unlinked by an update, deleted once no reader can access it. */
+        struct Garbage {
+            Garbage* nextGarbage;
+
+            virtual ~Garbage() {
+            }
+
+            void* operator new(size_t size) {
+                return FastHeap::allocate(size);
+            }
+
+            void operator delete(void* mem) {
+                FastHeap::deallocate(mem);
+            }
+        };
+
+        /** An immutable entry (except for its next link). */
+        struct Node final : Garbage {
+            const int hash;
+            const K key;
+            const V value;
+            std::atomic<Node*> next;
+
+            Node(int hash, const K& key, const V& value, Node* next) :
+                    hash(hash), key(key), value(value), next(next) {
+            }
+        };
+
+        /** Objects unlinked by an update; they are retired once no longer reachable from the table (new readers
+         *  could otherwise access them after the grace period). */
+        struct Unlinked {
+            Garbage* first;
+            Garbage* last;
+            int count;
+
+            Unlinked() :
+                    first(nullptr), last(nullptr), count(0) {
+            }
+
+            void add(Garbage* garbage) {
+                garbage->nextGarbage = first;
+                first = garbage;
+                if (last == nullptr)
+                    last = garbage;
+                ++count;
+            }
+        };
+
+        struct Table final : Garbage {
+            const int length; // Power of two.
+            std::atomic<std::uintptr_t>* const bins; // Head nodes, lock bit or MOVED.
+            std::atomic<Table*> next; // The table being transferred to (resize).
+            std::atomic<int> transferIndex; // The bins below this index have not been claimed for transfer.
+            std::atomic<int> transferred; // The number of bins transferred.
+
+            explicit Table(int length) :
+                    length(length), bins(new std::atomic<std::uintptr_t>[length]()), next(nullptr),
+                    transferIndex(length), transferred(0) {
+            }
+
+            ~Table() {
+                delete[] bins;
+            }
+
+            std::atomic<std::uintptr_t>& binOf(int hash) const {
+                return bins[hash & (length - 1)];
+            }
+        };
+
+        struct Stripe { // Cache line shared by a subset of the threads.
+            std::atomic<Type::int64> count; // The number of entries added minus removed.
+            std::atomic<Garbage*> garbage; // Objects unlinked, waiting to be deleted.
+            std::atomic<int> readers[2]; // The number of active readers for each phase.
+            std::atomic<int> garbageCount;
+            char padding[64 - 2 * sizeof(void*) - 3 * sizeof(int)]; // Not aligned (FastHeap), padded only.
+        };
+
+        /** The read-side critical section; the nodes and tables reachable are not deleted while active. */
+        class ReadSection {
+            std::atomic<int>* readers;
+        public:
+            explicit ReadSection(const Value* map) {
+                Stripe& stripe = map->stripes[stripeIndex()];
+                for (;;) {
+                    int phase = map->phase.load(std::memory_order_relaxed);
+                    readers = &stripe.readers[phase];
+                    readers->fetch_add(1);
+                    if (map->phase.load() == phase) // Otherwise a grace period may not wait for this reader.
+                        break;
+                    readers->fetch_sub(1, std::memory_order_release);
+                }
+                ++readDepth();
+            }
+
+            ~ReadSection() {
+                --readDepth();
+                readers->fetch_sub(1, std::memory_order_release);
+            }
+        };
+
+        /** Holds the lock of a bin; the bin is unlocked with its (possibly new) head on destruction, the nodes
+         *  unlinked are then retired. */
+        struct BinLock {
+            Value& map;
+            std::atomic<std::uintptr_t>& bin;
+            Node* head;
+            Unlinked unlinked;
+
+            BinLock(Value& map, std::atomic<std::uintptr_t>& bin) :
+                    map(map), bin(bin), head(reinterpret_cast<Node*>(bin.load(std::memory_order_relaxed) & ~LOCKED)) {
+            }
+
+            ~BinLock() {
+                bin.store(reinterpret_cast<std::uintptr_t>(head), std::memory_order_release);
+                map.retire(unlinked);
+            }
+
+            /** Searches the specified key; returns the link to its node (head if nullptr) and its position. */
+            Node* find(int hash, const K& key, std::atomic<Node*>*& link, int& position) const {
+                link = nullptr;
+                position = 0;
+                for (Node* node = head; node != nullptr; node = node->next.load(std::memory_order_relaxed)) {
+                    if ((node->hash == hash) && EQ::areEqual(node->key, key))
+                        return node;
+                    link = &node->next;
+                    ++position;
+                }
+                return nullptr;
+            }
+
+            /** Replaces the node at the specified link. */
+            void relink(std::atomic<Node*>* link, Node* node) {
+                if (link == nullptr)
+                    head = node;
+                else
+                    link->store(node, std::memory_order_release);
+            }
+        };
+
+        mutable Stripe stripes[STRIPES];
+        std::atomic<Table*> table;
+        std::atomic<int> phase; // Toggled by grace periods.
+        std::mutex reclaimLock;
+
+        static int stripeIndex() {
+            static std::atomic<int> threads(0);
+            static thread_local int index = threads.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+            return index;
+        }
+
+        /** The number of read sections active for the current thread (no grace period can be awaited). */
+        static int& readDepth() {
+            static thread_local int depth = 0;
+            return depth;
+        }
+
+        static int spread(int hashCode) { // As Java, the high bits also select the bins.
+            return (hashCode ^ (int) ((unsigned int) hashCode >> 16)) & 0x7FFFFFFF;
+        }
+
+        static Node* headOf(std::uintptr_t bin) {
+            return reinterpret_cast<Node*>(bin & ~LOCKED);
+        }
+
+        static void pause(int spin) {
+            if (spin > SPINS)
+                std::this_thread::yield();
+        }
+
+        /** Locks the specified bin; returns false if the bin has been transferred to the next table. */
+        static bool lock(std::atomic<std::uintptr_t>& bin) {
+            for (int spin = 0;; ++spin) {
+                std::uintptr_t head = bin.load(std::memory_order_relaxed);
+                if (head == MOVED)
+                    return false;
+                if (((head & LOCKED) == 0) && bin.compare_exchange_weak(head, head | LOCKED,
+                        std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+                pause(spin);
+            }
+        }
+
+        /** Searches the specified key (read section active). */
+        const Node* find(int hash, const K& key) const {
+            Table* t = table.load(std::memory_order_acquire);
+            for (;;) {
+                std::uintptr_t bin = t->binOf(hash).load(std::memory_order_acquire);
+                if (bin == MOVED) {
+                    t = t->next.load(std::memory_order_acquire);
+                    continue;
+                }
+                for (Node* node = headOf(bin); node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+                    if ((node->hash == hash) && EQ::areEqual(node->key, key))
+                        return node;
+                }
+                return nullptr;
+            }
+        }
+
+        /** Locks the bin of the specified key in the latest table (read section active). */
+        std::atomic<std::uintptr_t>& lockBinOf(int hash) {
+            Table* t = table.load(std::memory_order_acquire);
+            for (;;) {
+                std::atomic<std::uintptr_t>& bin = t->binOf(hash);
+                if (lock(bin))
+                    return bin;
+                Table* next = t->next.load(std::memory_order_acquire);
+                transfer(t, next); // Helps.
+                t = next;
+            }
+        }
+
+        /** Adds the specified objects to the garbage of the current thread stripe; they must be unreachable from
+         *  the table (only the readers already active may access them). */
+        void retire(Unlinked& unlinked) {
+            if (unlinked.count == 0)
+                return;
+            Stripe& stripe = stripes[stripeIndex()];
+            Garbage* head = stripe.garbage.load(std::memory_order_relaxed);
+            do {
+                unlinked.last->nextGarbage = head;
+            } while (!stripe.garbage.compare_exchange_weak(head, unlinked.first, std::memory_order_release,
+                    std::memory_order_relaxed));
+            stripe.garbageCount.fetch_add(unlinked.count, std::memory_order_relaxed);
+        }
+
+        /** Deletes the objects unlinked by the current thread stripe once no reader can access them. */
+        void reclaim() {
+            Stripe& stripe = stripes[stripeIndex()];
+            if ((stripe.garbageCount.load(std::memory_order_relaxed) < RECLAIM_THRESHOLD) || (readDepth() != 0))
+                return;
+            std::unique_lock<std::mutex> guard(reclaimLock, std::try_to_lock);
+            if (!guard.owns_lock()) // Another thread is waiting for a grace period.
+                return;
+            Garbage* garbage = stripe.garbage.exchange(nullptr, std::memory_order_acquire);
+            int count = 0;
+            for (Garbage* g = garbage; g != nullptr; g = g->nextGarbage)
+                ++count;
+            stripe.garbageCount.fetch_sub(count, std::memory_order_relaxed);
+            int previous = phase.load(std::memory_order_relaxed);
+            phase.store(1 - previous); // New readers announce themselves in the other phase.
+            for (int i = 0; i < STRIPES; ++i) {
+                for (int spin = 0; stripes[i].readers[previous].load() != 0; ++spin)
+                    pause(spin);
+            }
+            while (garbage != nullptr) {
+                Garbage* next = garbage->nextGarbage;
+                delete garbage;
+                garbage = next;
+            }
+        }
+
+        Type::int64 sumCount() const {
+            Type::int64 sum = 0;
+            for (int i = 0; i < STRIPES; ++i)
+                sum += stripes[i].count.load(std::memory_order_relaxed);
+            return sum;
+        }
+
+        /** Updates the count; the table is resized if an insertion collided or periodically (read section active). */
+        void addCount(int delta, int position) {
+            Type::int64 count = stripes[stripeIndex()].count.fetch_add(delta, std::memory_order_relaxed) + delta;
+            if ((delta <= 0) || ((position == 0) && ((count & 15) != 0)))
+                return;
+            Table* t = table.load(std::memory_order_acquire);
+            if ((sumCount() < t->length - (t->length >> 2)) || (t->length >= MAX_CAPACITY))
+                return;
+            Table* next = t->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                Table* created = new Table(t->length << 1);
+                if (t->next.compare_exchange_strong(next, created, std::memory_order_acq_rel))
+                    next = created;
+                else
+                    delete created; // Another thread started the resize.
+            }
+            transfer(t, next);
+        }
+
+        /** Transfers the unclaimed bins of the specified table; the last thread completing publishes the next
+         *  table. */
+        void transfer(Table* t, Table* next) {
+            for (;;) {
+                int end = t->transferIndex.load(std::memory_order_relaxed);
+                if (end <= 0)
+                    return;
+                int start = std::max(0, end - TRANSFER_STRIDE);
+                if (!t->transferIndex.compare_exchange_weak(end, start, std::memory_order_relaxed))
+                    continue;
+                for (int i = start; i < end; ++i)
+                    transferBin(t, next, i);
+                int done = end - start;
+                if (t->transferred.fetch_add(done, std::memory_order_acq_rel) + done == t->length) {
+                    table.store(next, std::memory_order_release);
+                    Unlinked unlinked;
+                    unlinked.add(t);
+                    retire(unlinked);
+                }
+            }
+        }
+
+        /** Splits a bin into the low and high bins of the next table; the trailing nodes going to the same bin
+         *  are reused, the others are copied (readers may still traverse them). */
+        void transferBin(Table* t, Table* next, int i) {
+            std::atomic<std::uintptr_t>& bin = t->bins[i];
+            lock(bin);
+            Node* head = headOf(bin.load(std::memory_order_relaxed));
+            Node* low = nullptr;
+            Node* high = nullptr;
+            Unlinked unlinked; // Retired once the bin is marked as moved.
+            if (head != nullptr) {
+                Node* lastRun = head;
+                int runBit = head->hash & t->length;
+                for (Node* node = head->next.load(std::memory_order_relaxed); node != nullptr;
+                        node = node->next.load(std::memory_order_relaxed)) {
+                    int bit = node->hash & t->length;
+                    if (bit != runBit) {
+                        runBit = bit;
+                        lastRun = node;
+                    }
+                }
+                (runBit == 0 ? low : high) = lastRun;
+                for (Node* node = head; node != lastRun; node = node->next.load(std::memory_order_relaxed)) {
+                    Node*& list = ((node->hash & t->length) == 0) ? low : high;
+                    list = new Node(node->hash, node->key, node->value, list);
+                    unlinked.add(node);
+                }
+            }
+            next->bins[i].store(reinterpret_cast<std::uintptr_t>(low), std::memory_order_release);
+            next->bins[i + t->length].store(reinterpret_cast<std::uintptr_t>(high), std::memory_order_release);
+            bin.store(MOVED, std::memory_order_release);
+            retire(unlinked);
+        }
+
+        template<class Action> static void forEach(const Table* t, int i, Action& action) {
+            std::uintptr_t bin = t->bins[i].load(std::memory_order_acquire);
+            if (bin == MOVED) {
+                const Table* next = t->next.load(std::memory_order_acquire);
+                forEach(next, i, action);
+                forEach(next, i + t->length, action);
+                return;
+            }
+            for (Node* node = headOf(bin); node != nullptr; node = node->next.load(std::memory_order_acquire))
+                action(node->key, node->value);
+        }
+
+    public:
+
+        /** Creates an empty map whose table has the specified initial capacity (rounded to a power of two). */
+        Value(int initialCapacity = MIN_CAPACITY) :
+                stripes(), phase(0) {
+            int capacity = MIN_CAPACITY;
+            while ((capacity < initialCapacity) && (capacity < MAX_CAPACITY))
+                capacity <<= 1;
+            table.store(new Table(capacity), std::memory_order_relaxed);
+        }
+
+        ~Value() {
+            Table* t = table.load(std::memory_order_relaxed);
+            for (int i = 0; i < t->length; ++i) {
+                Node* node = headOf(t->bins[i].load(std::memory_order_relaxed));
+                while (node != nullptr) {
+                    Node* next = node->next.load(std::memory_order_relaxed);
+                    delete node;
+                    node = next;
+                }
+            }
+            delete t;
+            for (int i = 0; i < STRIPES; ++i) {
+                Garbage* garbage = stripes[i].garbage.load(std::memory_order_relaxed);
+                while (garbage != nullptr) {
+                    Garbage* next = garbage->nextGarbage;
+                    delete garbage;
+                    garbage = next;
+                }
+            }
+        }
+
+        int size() const {
+            Type::int64 count = sumCount(); // Transiently negative if concurrently updated.
+            return (count < 0) ? 0 : (count > 0x7FFFFFFF) ? 0x7FFFFFFF : (int) count;
+        }
+
+        bool containsKey(const K& key) const {
+            ReadSection section(this);
+            return find(spread(EQ::hashOf(key)), key) != nullptr;
+        }
+
+        V getOrDefault(const K& key, const V& defaultValue) const {
+            ReadSection section(this);
+            const Node* node = find(spread(EQ::hashOf(key)), key);
+            return (node != nullptr) ? node->value : defaultValue;
+        }
+
+        V put(const K& key, const V& value, bool onlyIfAbsent) {
+            int hash = spread(EQ::hashOf(key));
+            V previous = V();
+            {
+                ReadSection section(this);
+                int position;
+                bool added = false;
+                {
+                    BinLock bin(*this, lockBinOf(hash));
+                    std::atomic<Node*>* link;
+                    Node* node = bin.find(hash, key, link, position);
+                    if (node == nullptr) {
+                        bin.head = new Node(hash, key, value, bin.head);
+                        added = true;
+                    } else {
+                        previous = node->value;
+                        if (!onlyIfAbsent) {
+                            bin.relink(link, new Node(hash, node->key, value,
+                                    node->next.load(std::memory_order_relaxed)));
+                            bin.unlinked.add(node);
+                        }
+                    }
+                }
+                if (added)
+                    addCount(1, position);
+            }
+            reclaim();
+            return previous;
+        }
+
+        template<class Function> V computeIfAbsent(const K& key, Function& mappingFunction) {
+            int hash = spread(EQ::hashOf(key));
+            {
+                ReadSection section(this);
+                const Node* node = find(hash, key);
+                if (node != nullptr)
+                    return node->value;
+            }
+            V value;
+            {
+                ReadSection section(this);
+                int position;
+                {
+                    BinLock bin(*this, lockBinOf(hash));
+                    std::atomic<Node*>* link;
+                    Node* node = bin.find(hash, key, link, position);
+                    if (node != nullptr)
+                        return node->value; // Concurrently added.
+                    value = mappingFunction(key);
+                    bin.head = new Node(hash, key, value, bin.head);
+                }
+                addCount(1, position);
+            }
+            reclaim();
+            return value;
+        }
+
+        V remove(const K& key) {
+            int hash = spread(EQ::hashOf(key));
+            V previous = V();
+            {
+                ReadSection section(this);
+                bool removed = false;
+                {
+                    BinLock bin(*this, lockBinOf(hash));
+                    std::atomic<Node*>* link;
+                    int position;
+                    Node* node = bin.find(hash, key, link, position);
+                    if (node != nullptr) {
+                        previous = node->value;
+                        bin.relink(link, node->next.load(std::memory_order_relaxed));
+                        bin.unlinked.add(node);
+                        removed = true;
+                    }
+                }
+                if (removed)
+                    addCount(-1, 0);
+            }
+            reclaim();
+            return previous;
+        }
+
+        void clear() {
+            {
+                ReadSection section(this);
+                Table* t = table.load(std::memory_order_acquire);
+                int removed = 0;
+                for (int i = 0; i < t->length;) {
+                    if (!lock(t->bins[i])) { // Resizing, continues with the next table.
+                        Table* next = t->next.load(std::memory_order_acquire);
+                        transfer(t, next);
+                        t = next;
+                        i = 0;
+                        continue;
+                    }
+                    BinLock bin(*this, t->bins[i++]);
+                    for (Node* node = bin.head; node != nullptr; node = node->next.load(std::memory_order_relaxed)) {
+                        bin.unlinked.add(node);
+                        ++removed;
+                    }
+                    bin.head = nullptr;
+                }
+                addCount(-removed, 0);
+            }
+            reclaim();
+        }
+
+        template<class Action> void forEach(Action& action) const {
+            ReadSection section(this);
+            const Table* t = table.load(std::memory_order_acquire);
+            for (int i = 0; i < t->length; ++i)
+                forEach(t, i, action);
+        }
+
+        String toString() const override {
+            StringBuilder sb = new StringBuilder::Value();
+            sb.append('{');
+            bool first = true;
+            auto append = [&](const K& key, const V& value) {
+                if (!first)
+                    sb.append(", ");
+                first = false;
+                sb.append(String::valueOf(key)).append('=').append(String::valueOf(value));
+            };
+            forEach(append);
+            return sb.append('}').toString();
+        }
+
+    };
+
+    CLASS(ConcurrentHashMap)
+
+    /**
+     * Returns the number of entries in this map (estimate if the map is concurrently updated).
+     */
+    int size() const {
+        return this_<Value>()->size();
+    }
+
+    /**
+     * Indicates if this map is empty.
+     */
+    bool isEmpty() const {
+        return this_<Value>()->size() == 0;
+    }
+
+    /**
+     * Indicates if this map contains the specified key.
+     */
+    bool containsKey(const K& key) const {
+        return this_<Value>()->containsKey(key);
+    }
+
+    /**
+     * Returns the value associated to the specified key or a default-constructed value (e.g. null) if none.
+     */
+    V get(const K& key) const {
+        return this_<Value>()->getOrDefault(key, V());
+    }
+
+    /**
+     * Returns the value associated to the specified key or the specified default value if none.
+     */
+    V getOrDefault(const K& key, const V& defaultValue) const {
+        return this_<Value>()->getOrDefault(key, defaultValue);
+    }
+
+    /**
+     * Associates the specified value to the specified key and returns the previous value (or a default-constructed
+     * value if none).
+     */
+    V put(const K& key, const V& value) {
+        return this_<Value>()->put(key, value, false);
+    }
+
+    /**
+     * Associates the specified value to the specified key if not already present; returns the current value
+     * (or a default-constructed value if none).
+     */
+    V putIfAbsent(const K& key, const V& value) {
+        return this_<Value>()->put(key, value, true);
+    }
+
+    /**
+     * Returns the value associated to the specified key; if none, the value is computed by the specified function
+     * and entered into this map. The function is invoked at most once per key (other updates of the same bin are
+     * blocked during the computation); it should be short and must not update this map.
+     */
+    template<class Function> V computeIfAbsent(const K& key, Function mappingFunction) {
+        return this_<Value>()->computeIfAbsent(key, mappingFunction);
+    }
+
+    /**
+     * Removes the entry for the specified key and returns its value (or a default-constructed value if none).
+     */
+    V remove(const K& key) {
+        return this_<Value>()->remove(key);
+    }
+
+    /**
+     * Removes all the entries of this map.
+     */
+    void clear() {
+        this_<Value>()->clear();
+    }
+
+    /**
+     * Performs an action for each entry of this map (unspecified order). The traversal reflects the state of the
+     * map at some point at or since its start; the action should not block (entries removed concurrently
+     * are not deleted until it completes).
+     */
+    template<class Action> void forEach(Action action) const {
+        this_<Value>()->forEach(action);
+    }
+
+};
+
+}
+}
+}
@@ -0,0 +1,293 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include "java/lang/Object.hpp"
+#include "java/lang/IllegalArgumentException.hpp"
+#include "java/util/FastTable.hpp"
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * <p> A bounded lock-free queue for any number of producer and consumer threads.</p>
+ *
+ * <p> The queue is an array of slots each having a sequence number (Dmitry Vyukov's algorithm): a producer or a
+ *     consumer claims a position with a single compare-and-swap, then publishes the slot through its sequence
+ *     number. Contention is limited to the producers index and the consumers index, each on its own cache line.
+ *     Elements are moved in and out of the slots, object handles are transferred without reference counting.
+ *     Batch operations (offerAll, drain) claim a run of ready slots at once.</p>
+ *
+ * <pre><code>
+ * MpmcArrayQueue<Runnable> tasks = new MpmcArrayQueue<Runnable>::Value(1024);
+ * if (!tasks.offer(std::move(task))) { ... } // Full.
+ * Runnable next = tasks.poll(); // Null if empty.
+ * </code></pre>
+ *
+ * @see  <a href="http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue">
+ *       Bounded MPMC queue</a>
+ * @version 7.0
+ */
+template<typename E> class MpmcArrayQueue final : public Object {
+public:
+    class Value final : public Object::Value {
+        static const int CACHE_LINE = 64;
+        typedef std::atomic<std::size_t> Index;
+
+        struct Slot {
+            Index sequence; // Position + 1 when filled, position + capacity when free for the next round.
+            E element;
+        };
+
+        /** Releases the slots claimed by a consumer (the remaining ones are cleared if the consumer throws). */
+        struct Release {
+            Value& queue;
+            std::size_t position;
+            const std::size_t end;
+
+            Release(Value& queue, std::size_t position, std::size_t end) :
+                    queue(queue), position(position), end(end) {
+            }
+
+            ~Release() {
+                for (; position != end; ++position) {
+                    Slot& slot = queue.slotAt(position);
+                    slot.element = E();
+                    slot.sequence.store(position + queue.mask + 1, std::memory_order_release);
+                }
+            }
+        };
+
+        const std::size_t mask;
+        Slot* const slots;
+        char padding0[CACHE_LINE];
+        Index tail; // The next position to fill (producers).
+        char padding1[CACHE_LINE - sizeof(Index)];
+        Index head; // The next position to empty (consumers).
+        char padding2[CACHE_LINE - sizeof(Index)];
+
+        static std::size_t capacityFor(int capacity) {
+            if (capacity <= 0)
+                throw IllegalArgumentException("Invalid capacity: " + String::valueOf(capacity));
+            std::size_t n = 2;
+            while (n < (std::size_t) capacity)
+                n <<= 1;
+            return n;
+        }
+
+        Slot& slotAt(std::size_t position) const {
+            return slots[position & mask];
+        }
+
+    public:
+
+        /** Creates a queue having at least the specified capacity (rounded up to a power of two). */
+        Value(int capacity) :
+                mask(capacityFor(capacity) - 1), slots(new Slot[mask + 1]), tail(0), head(0) {
+            for (std::size_t i = 0; i <= mask; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~Value() {
+            delete[] slots;
+        }
+
+        int capacity() const {
+            return (int) (mask + 1);
+        }
+
+        int size() const {
+            std::size_t h = head.load(std::memory_order_acquire);
+            std::size_t t = tail.load(std::memory_order_acquire);
+            return (t > h) ? (int) std::min(t - h, mask + 1) : 0; // Estimate.
+        }
+
+        template<typename T> bool offer(T&& element) {
+            std::size_t position = tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot& slot = slotAt(position);
+                std::ptrdiff_t diff = (std::ptrdiff_t) (slot.sequence.load(std::memory_order_acquire) - position);
+                if (diff == 0) {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.element = std::forward<T>(element);
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) { // The slot has not been emptied since the previous round.
+                    return false;
+                } else {
+                    position = tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool poll(E& element) {
+            std::size_t position = head.load(std::memory_order_relaxed);
+            for (;;) {
+                Slot& slot = slotAt(position);
+                std::ptrdiff_t diff = (std::ptrdiff_t) (slot.sequence.load(std::memory_order_acquire) - (position + 1));
+                if (diff == 0) {
+                    if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        element = std::move(slot.element);
+                        slot.sequence.store(position + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) { // The slot has not been filled yet.
+                    return false;
+                } else {
+                    position = head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        int offerAll(E* elements, int count) {
+            int offered = 0;
+            while (offered < count) {
+                std::size_t position = tail.load(std::memory_order_relaxed);
+                std::size_t ready = 0; // The number of consecutive free slots.
+                while ((offered + (int) ready < count)
+                        && (slotAt(position + ready).sequence.load(std::memory_order_acquire) == position + ready))
+                    ++ready;
+                if (ready == 0) {
+                    if ((std::ptrdiff_t) (slotAt(position).sequence.load(std::memory_order_acquire) - position) < 0)
+                        break; // Full.
+                    continue;
+                }
+                if (!tail.compare_exchange_weak(position, position + ready, std::memory_order_relaxed))
+                    continue;
+                for (std::size_t i = 0; i < ready; ++i) {
+                    Slot& slot = slotAt(position + i);
+                    slot.element = std::move(elements[offered++]);
+                    slot.sequence.store(position + i + 1, std::memory_order_release);
+                }
+            }
+            return offered;
+        }
+
+        template<class Consumer> int drain(Consumer& consumer, int limit) {
+            int drained = 0;
+            while (drained < limit) {
+                std::size_t position = head.load(std::memory_order_relaxed);
+                std::size_t ready = 0; // The number of consecutive filled slots.
+                while ((drained + (int) ready < limit)
+                        && (slotAt(position + ready).sequence.load(std::memory_order_acquire) == position + ready + 1))
+                    ++ready;
+                if (ready == 0) {
+                    if ((std::ptrdiff_t) (slotAt(position).sequence.load(std::memory_order_acquire) - (position + 1)) < 0)
+                        break; // Empty.
+                    continue;
+                }
+                if (!head.compare_exchange_weak(position, position + ready, std::memory_order_relaxed))
+                    continue;
+                Release release(*this, position, position + ready);
+                while (release.position != release.end) {
+                    Slot& slot = slotAt(release.position);
+                    E element = std::move(slot.element);
+                    slot.sequence.store(release.position + mask + 1, std::memory_order_release);
+                    ++release.position;
+                    ++drained;
+                    consumer(std::move(element));
+                }
+            }
+            return drained;
+        }
+
+    };
+
+    CLASS(MpmcArrayQueue)
+
+    /**
+     * Returns the capacity of this queue.
+     */
+    int capacity() const {
+        return this_<Value>()->capacity();
+    }
+
+    /**
+     * Returns the number of elements in this queue (estimate if the queue is concurrently updated).
+     */
+    int size() const {
+        return this_<Value>()->size();
+    }
+
+    /**
+     * Indicates if this queue is empty (estimate if the queue is concurrently updated).
+     */
+    bool isEmpty() const {
+        return this_<Value>()->size() == 0;
+    }
+
+    /**
+     * Inserts a copy of the specified element if this queue is not full; returns false otherwise.
+     */
+    bool offer(const E& element) {
+        return this_<Value>()->offer(element);
+    }
+
+    /**
+     * Moves the specified element into this queue if not full; returns false otherwise (the element is unchanged).
+     */
+    bool offer(E&& element) {
+        return this_<Value>()->offer(std::move(element));
+    }
+
+    /**
+     * Moves as many of the specified elements as possible into this queue; returns the number of elements moved
+     * (from the start of the specified elements).
+     */
+    int offerAll(E* elements, int count) {
+        return this_<Value>()->offerAll(elements, count);
+    }
+
+    /**
+     * Removes the head of this queue into the specified element; returns false if this queue is empty.
+     */
+    bool poll(E& element) {
+        return this_<Value>()->poll(element);
+    }
+
+    /**
+     * Removes and returns the head of this queue or a default-constructed element (e.g. null) if this queue is
+     * empty.
+     */
+    E poll() {
+        E element = E();
+        this_<Value>()->poll(element);
+        return element;
+    }
+
+    /**
+     * Removes up to the specified number of elements from this queue and passes them (rvalues) to the specified
+     * consumer; returns the number of elements removed. The ready slots are claimed in batches; if the consumer
+     * throws, the exception is propagated and the elements of the batch not yet consumed are discarded (other
+     * consumers may have claimed the following slots already).
+     */
+    template<class Consumer> int drain(Consumer consumer, int limit = std::numeric_limits<int>::max()) {
+        return this_<Value>()->drain(consumer, limit);
+    }
+
+    /**
+     * Removes up to the specified number of elements from this queue and appends them to the specified table;
+     * returns the number of elements transferred.
+     */
+    int drainTo(FastTable<E>& table, int limit = std::numeric_limits<int>::max()) {
+        auto add = [&](E&& element) {
+            table.addLast(std::move(element));
+        };
+        return this_<Value>()->drain(add, limit);
+    }
+
+};
+
+}
+}
+}
@@ -0,0 +1,257 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include "java/lang/Object.hpp"
+#include "java/lang/IllegalArgumentException.hpp"
+#include "java/util/FastTable.hpp"
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * <p> A bounded wait-free queue (ring buffer) for a single producer thread and a single consumer thread.</p>
+ *
+ * <p> The producer and the consumer each own a cache line holding their index and a cached copy of the other
+ *     index; the other index is only read when the cached copy indicates that the queue is full (producer) or
+ *     empty (consumer). Elements are moved in and out of the ring, object handles are transferred without
+ *     reference counting. Batch operations (offerAll, drain) publish their elements with a single store.</p>
+ *
+ * <pre><code>
+ * SpscArrayQueue<String> messages = new SpscArrayQueue<String>::Value(4096);
+ * messages.offer(message); // Producer thread.
+ * ...
+ * messages.drain([](String&& message) { ... }); // Consumer thread.
+ * </code></pre>
+ *
+ * <p> Note: At any time, at most one thread may insert elements and at most one thread may remove elements.</p>
+ *
+ * @version 7.0
+ */
+template<typename E> class SpscArrayQueue final : public Object {
+public:
+    class Value final : public Object::Value {
+        static const int CACHE_LINE = 64;
+        typedef std::atomic<std::size_t> Index;
+
+        /** Releases the slots claimed by a consumer (the remaining ones are cleared if the consumer throws). */
+        struct Release {
+            Value& queue;
+            std::size_t position;
+            const std::size_t end;
+
+            Release(Value& queue, std::size_t position, std::size_t end) :
+                    queue(queue), position(position), end(end) {
+            }
+
+            ~Release() {
+                for (; position != end; ++position)
+                    queue.elements[position & queue.mask] = E();
+                queue.head.store(end, std::memory_order_release);
+            }
+        };
+
+        const std::size_t mask;
+        E* const elements;
+        char padding0[CACHE_LINE];
+        Index tail; // The next position to fill.
+        std::size_t headCache; // The consumer index last read by the producer.
+        char padding1[CACHE_LINE - sizeof(Index) - sizeof(std::size_t)];
+        Index head; // The next position to empty.
+        std::size_t tailCache; // The producer index last read by the consumer.
+        char padding2[CACHE_LINE - sizeof(Index) - sizeof(std::size_t)];
+
+        static std::size_t capacityFor(int capacity) {
+            if (capacity <= 0)
+                throw IllegalArgumentException("Invalid capacity: " + String::valueOf(capacity));
+            std::size_t n = 1;
+            while (n < (std::size_t) capacity)
+                n <<= 1;
+            return n;
+        }
+
+        /** Returns the number of free slots (producer). */
+        std::size_t available(std::size_t t, std::size_t wanted) {
+            std::size_t free = mask + 1 - (t - headCache);
+            if (free < wanted) {
+                headCache = head.load(std::memory_order_acquire);
+                free = mask + 1 - (t - headCache);
+            }
+            return free;
+        }
+
+        /** Returns the number of filled slots (consumer). */
+        std::size_t filled(std::size_t h, std::size_t wanted) {
+            std::size_t count = tailCache - h;
+            if (count < wanted) {
+                tailCache = tail.load(std::memory_order_acquire);
+                count = tailCache - h;
+            }
+            return count;
+        }
+
+    public:
+
+        /** Creates a queue having at least the specified capacity (rounded up to a power of two). */
+        Value(int capacity) :
+                mask(capacityFor(capacity) - 1), elements(new E[mask + 1]()), tail(0), headCache(0), head(0),
+                tailCache(0) {
+        }
+
+        ~Value() {
+            delete[] elements;
+        }
+
+        int capacity() const {
+            return (int) (mask + 1);
+        }
+
+        int size() const {
+            std::size_t h = head.load(std::memory_order_acquire);
+            std::size_t t = tail.load(std::memory_order_acquire);
+            return (t > h) ? (int) std::min(t - h, mask + 1) : 0;
+        }
+
+        template<typename T> bool offer(T&& element) {
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (available(t, 1) == 0)
+                return false;
+            elements[t & mask] = std::forward<T>(element);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool poll(E& element) {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (filled(h, 1) == 0)
+                return false;
+            element = std::move(elements[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        int offerAll(E* src, int count) {
+            if (count <= 0)
+                return 0;
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            std::size_t n = std::min(available(t, (std::size_t) count), (std::size_t) count);
+            for (std::size_t i = 0; i < n; ++i)
+                elements[(t + i) & mask] = std::move(src[i]);
+            tail.store(t + n, std::memory_order_release);
+            return (int) n;
+        }
+
+        template<class Consumer> int drain(Consumer& consumer, int limit) {
+            if (limit <= 0)
+                return 0;
+            std::size_t h = head.load(std::memory_order_relaxed);
+            std::size_t n = std::min(filled(h, (std::size_t) limit), (std::size_t) limit);
+            Release release(*this, h, h + n);
+            while (release.position != release.end) {
+                E element = std::move(elements[release.position++ & mask]);
+                consumer(std::move(element));
+            }
+            return (int) n;
+        }
+
+    };
+
+    CLASS(SpscArrayQueue)
+
+    /**
+     * Returns the capacity of this queue.
+     */
+    int capacity() const {
+        return this_<Value>()->capacity();
+    }
+
+    /**
+     * Returns the number of elements in this queue (estimate if the queue is concurrently updated).
+     */
+    int size() const {
+        return this_<Value>()->size();
+    }
+
+    /**
+     * Indicates if this queue is empty (estimate if the queue is concurrently updated).
+     */
+    bool isEmpty() const {
+        return this_<Value>()->size() == 0;
+    }
+
+    /**
+     * Inserts a copy of the specified element if this queue is not full; returns false otherwise (producer).
+     */
+    bool offer(const E& element) {
+        return this_<Value>()->offer(element);
+    }
+
+    /**
+     * Moves the specified element into this queue if not full; returns false otherwise, the element is unchanged
+     * (producer).
+     */
+    bool offer(E&& element) {
+        return this_<Value>()->offer(std::move(element));
+    }
+
+    /**
+     * Moves as many of the specified elements as possible into this queue; returns the number of elements moved
+     * (from the start of the specified elements). The elements become visible to the consumer all at once
+     * (producer).
+     */
+    int offerAll(E* elements, int count) {
+        return this_<Value>()->offerAll(elements, count);
+    }
+
+    /**
+     * Removes the head of this queue into the specified element; returns false if this queue is empty (consumer).
+     */
+    bool poll(E& element) {
+        return this_<Value>()->poll(element);
+    }
+
+    /**
+     * Removes and returns the head of this queue or a default-constructed element (e.g. null) if this queue is
+     * empty (consumer).
+     */
+    E poll() {
+        E element = E();
+        this_<Value>()->poll(element);
+        return element;
+    }
+
+    /**
+     * Removes up to the specified number of elements from this queue and passes them (rvalues) to the specified
+     * consumer; returns the number of elements removed. The slots are released to the producer all at once
+     * (consumer). If the consumer throws, the exception is propagated and the elements of the batch not yet
+     * consumed are discarded (as for MpmcArrayQueue).
+     */
+    template<class Consumer> int drain(Consumer consumer, int limit = std::numeric_limits<int>::max()) {
+        return this_<Value>()->drain(consumer, limit);
+    }
+
+    /**
+     * Removes up to the specified number of elements from this queue and appends them to the specified table;
+     * returns the number of elements transferred (consumer).
+     */
+    int drainTo(FastTable<E>& table, int limit = std::numeric_limits<int>::max()) {
+        auto add = [&](E&& element) {
+            table.addLast(std::move(element));
+        };
+        return this_<Value>()->drain(add, limit);
+    }
+
+};
+
+}
+}
+}
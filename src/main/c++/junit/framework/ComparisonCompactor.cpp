@@ -21,8 +21,8 @@ String ComparisonCompactor::Value::compact(const String& message) {
 }
 
 String ComparisonCompactor::Value::compactString(const String& source) {
-    static const String DELTA_END = "]";
-    static const String DELTA_START = "[";
+    static const String::Literal DELTA_END("]");
+    static const String::Literal DELTA_START("[");
     String result = DELTA_START + source.substring(fPrefix, source.length() - fSuffix + 1) + DELTA_END;
     if (fPrefix > 0) {
         result = computeCommonPrefix() + result;
@@ -55,16 +55,18 @@ void ComparisonCompactor::Value::findCommonSuffix() {
 }
 
 String ComparisonCompactor::Value::computeCommonPrefix() {
-    static const String ELLIPSIS = "...";
-    return (fPrefix > fContextLength ? ELLIPSIS : "")
+    static const String::Literal ELLIPSIS("...");
+    static const String::Literal EMPTY("");
+    return String(fPrefix > fContextLength ? ELLIPSIS : EMPTY)
             + fExpected.substring(Math::max(0, fPrefix - fContextLength), fPrefix);
 }
 
 String ComparisonCompactor::Value::computeCommonSuffix() {
-    static const String ELLIPSIS = "...";
+    static const String::Literal ELLIPSIS("...");
+    static const String::Literal EMPTY("");
     int end = Math::min(fExpected.length() - fSuffix + 1 + fContextLength, fExpected.length());
     return fExpected.substring(fExpected.length() - fSuffix + 1, end)
-            + (fExpected.length() - fSuffix + 1 < fExpected.length() - fContextLength ? ELLIPSIS : "");
+            + (fExpected.length() - fSuffix + 1 < fExpected.length() - fContextLength ? ELLIPSIS : EMPTY);
 }
 
 bool ComparisonCompactor::Value::areStringsEqual() {
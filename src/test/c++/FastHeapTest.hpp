@@ -0,0 +1,125 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/util/concurrent/ConcurrentTests.hpp"
+
+/**
+ * Tests of the fast heap growth (each test sizes its own size class, the heap being enabled).
+ *
+ * @version 7.0
+ */
+class FastHeapTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+
+        /** Allocates the specified number of blocks of the specified size class, each filled with its index. */
+        static std::vector<char*> allocate(int sizeClass, int count) {
+            std::vector<char*> blocks;
+            for (int i = 0; i < count; ++i) {
+                char* block = static_cast<char*>(FastHeap::allocate(FastHeap::getBlockSize(sizeClass)));
+                std::memset(block, (char) i, FastHeap::getBlockSize(sizeClass));
+                blocks.push_back(block);
+            }
+            return blocks;
+        }
+
+        /** Deallocates the specified blocks; returns the number of blocks overwritten meanwhile. */
+        static int deallocate(int sizeClass, const std::vector<char*>& blocks) {
+            int corrupted = 0;
+            for (int i = 0; i < (int) blocks.size(); ++i) {
+                for (size_t j = 0; j < FastHeap::getBlockSize(sizeClass); ++j) {
+                    if (blocks[i][j] != (char) i) {
+                        ++corrupted;
+                        break;
+                    }
+                }
+                FastHeap::deallocate(blocks[i]);
+            }
+            return corrupted;
+        }
+
+        /** Asserts that no allocation of the specified size class used the system heap since the specified count
+         *  was read (unchecked heap only, the quarantined blocks of a checked heap can exhaust the size class). */
+        static void assertNoSystemHeap(int sizeClass, long systemHeapCount) {
+#ifndef JAVOLUTION_FASTHEAP_CHECKED
+            assertEquals("system heap", systemHeapCount, (long) FastHeap::getSystemHeapCount(sizeClass));
+#endif
+        }
+
+        /** The allocating thread grows the size class up to its maximum size (no background growth); the blocks
+         *  freed return to their arena and are reused. */
+        void testGrowthByAllocatingThread() {
+            FastHeap::setMaxSize(1, 4096);
+            FastHeap::setSize(1, 512);
+            long systemHeapCount = (long) FastHeap::getSystemHeapCount(1);
+            for (int round = 0; round < 2; ++round) {
+                std::vector<char*> blocks = allocate(1, 3500);
+                assertEquals("corrupted", 0, deallocate(1, blocks));
+            }
+            assertNoSystemHeap(1, systemHeapCount);
+            assertTrue("grown", FastHeap::getArenaCount(1) > FastHeap::getNodeCount());
+            assertTrue(FastHeap::getSize(1, 0) <= FastHeap::getMaxSize(1));
+        }
+
+        /** The background thread adds an arena before the size class is exhausted; it is stopped on request. */
+        void testBackgroundGrowth() {
+            FastHeap::setMaxSize(2, 2048);
+            FastHeap::setSize(2, 256);
+            FastHeap::setBackgroundGrowth(true);
+            assertTrue(FastHeap::isBackgroundGrowth());
+            std::vector<char*> blocks = allocate(2, 220); // Less than a quarter of an arena free.
+            for (int i = 0; (i < 1000) && (FastHeap::getArenaCount(2) == FastHeap::getNodeCount()); ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            FastHeap::setBackgroundGrowth(false);
+            assertFalse(FastHeap::isBackgroundGrowth());
+            assertTrue("grown", FastHeap::getArenaCount(2) > FastHeap::getNodeCount());
+            assertEquals("corrupted", 0, deallocate(2, blocks));
+        }
+
+        /** Concurrent allocations and deallocations while the size class grows (shared queues of several
+         *  arenas). */
+        void testConcurrentAllocations() {
+            FastHeap::setMaxSize(0, 4096);
+            FastHeap::setSize(0, 256);
+            long systemHeapCount = (long) FastHeap::getSystemHeapCount(0);
+            std::atomic<int> corrupted(0);
+            int errors = java::util::concurrent::runConcurrently(8, [&](int) {
+                for (int round = 0; round < 100; ++round) {
+                    std::vector<char*> blocks = allocate(0, 200 + round);
+                    corrupted += deallocate(0, blocks);
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertEquals("corrupted", 0, corrupted.load());
+            assertNoSystemHeap(0, systemHeapCount);
+        }
+
+    };
+
+    CLASS_BASE(FastHeapTest, TestCase)
+
+    TEST(testGrowthByAllocatingThread)
+    TEST(testBackgroundGrowth)
+    TEST(testConcurrentAllocations)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("FastHeapTest");
+        tests.addTest(new testGrowthByAllocatingThread());
+        tests.addTest(new testBackgroundGrowth());
+        tests.addTest(new testConcurrentAllocations());
+        return tests;
+    }
+
+};
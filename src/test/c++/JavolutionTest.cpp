@@ -0,0 +1,80 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+
+#include "java/lang/System.hpp"
+#include "junit/framework/TestListener.hpp"
+#include "junit/framework/TestResult.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "FastHeapTest.hpp"
+#include "java/lang/ArrayTest.hpp"
+#include "java/lang/DoubleTest.hpp"
+#include "java/lang/IntegerTest.hpp"
+#include "java/lang/LongTest.hpp"
+#include "java/lang/StringBuilderTest.hpp"
+#include "java/lang/StringTest.hpp"
+#include "java/util/FastMapTest.hpp"
+#include "java/util/FastTableTest.hpp"
+#include "java/util/SparseArrayTest.hpp"
+#include "java/util/concurrent/ConcurrentHashMapTest.hpp"
+#include "java/util/concurrent/MpmcArrayQueueTest.hpp"
+#include "java/util/concurrent/SpscArrayQueueTest.hpp"
+
+using namespace java::lang;
+using namespace junit::framework;
+
+/** Prints the progress and the failures of the tests. */
+class TestPrinter : public TestListener {
+public:
+    class Value : public Object::Value, public virtual TestListener::Interface {
+    public:
+        void addError(const Test& test, const Throwable& e) override {
+            System::out.println("ERROR: " + test.toString() + ": " + e.getMessage());
+        }
+
+        void addFailure(const Test& test, const AssertionFailedError& e) override {
+            System::out.println("FAILURE: " + test.toString() + ": " + e.getMessage());
+        }
+
+        void endTest(const Test&) override {
+        }
+
+        void startTest(const Test& test) override {
+            System::out.println(test.toString());
+        }
+    };
+
+    CLASS_BASE(TestPrinter, TestListener)
+};
+
+/**
+ * Runs the Javolution tests (fast heap enabled), returns a non-zero status if any test fails. The tests are not
+ * part of the library; they are built against it, e.g. <code>g++ -std=c++11 -Isrc/main/c++ -Isrc/test/c++
+ * src/test/c++/JavolutionTest.cpp libjavolution.a -lpthread -ldl</code>
+ */
+int main() {
+    FastHeap::setSize(64 * 1024);
+    FastHeap::enable();
+    TestSuite tests = new TestSuite::Value("Javolution");
+    tests.addTest(FastHeapTest::suite());
+    tests.addTest(java::lang::ArrayTest::suite());
+    tests.addTest(java::lang::DoubleTest::suite());
+    tests.addTest(java::lang::IntegerTest::suite());
+    tests.addTest(java::lang::LongTest::suite());
+    tests.addTest(java::lang::StringBuilderTest::suite());
+    tests.addTest(java::lang::StringTest::suite());
+    tests.addTest(java::util::FastMapTest::suite());
+    tests.addTest(java::util::FastTableTest::suite());
+    tests.addTest(java::util::SparseArrayTest::suite());
+    tests.addTest(java::util::concurrent::ConcurrentHashMapTest::suite());
+    tests.addTest(java::util::concurrent::MpmcArrayQueueTest::suite());
+    tests.addTest(java::util::concurrent::SpscArrayQueueTest::suite());
+    TestResult result = new TestResult::Value();
+    result.addListener(new TestPrinter::Value());
+    tests.run(result);
+    System::out.println(String::valueOf(result.runCount()) + " tests, " + String::valueOf(result.failureCount())
+            + " failures, " + String::valueOf(result.errorCount()) + " errors");
+    return result.wasSuccessful() ? 0 : 1;
+}
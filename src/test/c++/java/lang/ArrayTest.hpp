@@ -0,0 +1,206 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Array.hpp"
+#include "java/lang/String.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Tests of the fractal arrays: growth and shrinking across the fractal levels, blocks allocated on demand,
+ * clones and flat arrays.
+ *
+ * @version 7.0
+ */
+class ArrayTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+
+        /** An element counting its live instances and its constructions (elements of the blocks allocated). */
+        struct Counted {
+            static int& live() {
+                static int count = 0;
+                return count;
+            }
+            static int& constructed() {
+                static int count = 0;
+                return count;
+            }
+
+            int value;
+
+            Counted() :
+                    value(0) {
+                ++live();
+                ++constructed();
+            }
+            Counted(const Counted& that) :
+                    value(that.value) {
+                ++live();
+                ++constructed();
+            }
+            Counted& operator=(const Counted& that) = default;
+            ~Counted() {
+                --live();
+            }
+        };
+
+        static const int SEGMENT_SIZE = Array<Counted>::SEGMENT_SIZE;
+
+        /** Returns the number of elements of the blocks holding the specified number of elements. */
+        static int blocksCapacity(int length) {
+            return (length + SEGMENT_SIZE - 1) / SEGMENT_SIZE * SEGMENT_SIZE;
+        }
+
+        /** Growing across the fractal levels allocates only the blocks covering the new length (even
+         *  transiently). */
+        void testGrowthAllocatesOnDemand() {
+            int live = Counted::live();
+            {
+                Array<Counted> array = Array<Counted>::newInstance(SEGMENT_SIZE);
+                int lengths[] = { SEGMENT_SIZE + 1, 16 * SEGMENT_SIZE, 16 * SEGMENT_SIZE + 1, 256 * SEGMENT_SIZE + 1,
+                        259 * SEGMENT_SIZE + 7 };
+                int previous = SEGMENT_SIZE;
+                for (int length : lengths) {
+                    for (int i = 0; i < previous; ++i)
+                        array[i].value = i;
+                    int constructed = Counted::constructed();
+                    array.setLength(length);
+                    int added = blocksCapacity(length) - blocksCapacity(previous);
+                    int transient = Counted::constructed() - constructed - added; // Default elements clearing leaves.
+                    assertTrue("transient blocks", transient < added / SEGMENT_SIZE + SEGMENT_SIZE);
+                    assertEquals(String::valueOf(length), (long) blocksCapacity(length),
+                            (long) (Counted::live() - live));
+                    for (int i = 0; i < previous; ++i)
+                        assertEquals((long) i, (long) array[i].value);
+                    for (int i = previous; i < length; ++i)
+                        assertEquals(0L, (long) array[i].value);
+                    previous = length;
+                }
+            }
+            assertEquals("released", (long) live, (long) Counted::live());
+        }
+
+        /** Shrinking drops the elements at and after the new length and the blocks beyond it. */
+        void testShrinkAndRegrow() {
+            const int length = 20 * SEGMENT_SIZE + 3;
+            const int shrunk = 3 * SEGMENT_SIZE + 5;
+            Array<String> strings = Array<String>::newInstance(length);
+            for (int i = 0; i < length; ++i)
+                strings[i] = String::valueOf(i);
+            strings.setLength(shrunk);
+            strings.setLength(length);
+            for (int i = 0; i < shrunk; ++i)
+                assertEquals(String::valueOf(i), strings[i]);
+            for (int i = shrunk; i < length; ++i)
+                assertTrue(strings[i] == nullptr);
+            int live = Counted::live();
+            Array<Counted> counted = Array<Counted>::newInstance(length);
+            counted.setLength(shrunk);
+            assertEquals((long) blocksCapacity(shrunk), (long) (Counted::live() - live));
+        }
+
+        /** Clones copy the elements of each block once (no block allocated and then overwritten). */
+        void testClone() {
+            const int length = 17 * SEGMENT_SIZE + 3;
+            Array<Counted> array = Array<Counted>::newInstance(length);
+            for (int i = 0; i < length; ++i)
+                array[i].value = i;
+            int constructed = Counted::constructed();
+            Array<Counted> copy = array.clone();
+            assertEquals((long) blocksCapacity(length), (long) (Counted::constructed() - constructed));
+            assertEquals((long) length, (long) copy.length);
+            for (int i = 0; i < length; ++i)
+                copy[i].value = -i;
+            for (int i = 1; i < length; ++i) {
+                assertEquals((long) i, (long) array[i].value);
+                assertEquals((long) -i, (long) copy[i].value);
+            }
+        }
+
+        /** Primitive elements are preserved across the fractal levels (up and down). */
+        void testPrimitiveElements() {
+            Array<int> ints = Array<int>::newInstance(1);
+            ints[0] = 0;
+            for (int length = 2; length <= 300 * Array<int>::SEGMENT_SIZE; length = length * 3 / 2 + 1) {
+                int previous = ints.length;
+                ints.setLength(length);
+                for (int i = previous; i < length; ++i)
+                    ints[i] = i;
+            }
+            ints.setLength(5 * Array<int>::SEGMENT_SIZE + 1);
+            int index = 0;
+            int mismatches = 0;
+            ints.forEachSegment(0, ints.length, [&](int* segment, int n) {
+                for (int i = 0; i < n; ++i, ++index)
+                    mismatches += (segment[i] != index);
+            });
+            assertEquals((long) ints.length, (long) index);
+            assertEquals(0L, (long) mismatches);
+        }
+
+        /** Flat arrays are allocated through the FastHeap: from its blocks when small enough, else from the
+         *  system heap (counted); their elements are value-initialized and released. */
+        void testFlatInstances() {
+            const int largest = FastHeap::SIZE_CLASSES - 1; // Blocks of MAX_BLOCK_SIZE bytes.
+            if (FastHeap::getSize(largest) == 0)
+                FastHeap::setSize(largest, 64);
+            Type::int64 systemHeapCount = FastHeap::getSystemHeapCount();
+            const int small = (int) (FastHeap::MAX_BLOCK_SIZE / sizeof(int)) / 2;
+            Array<int> ints = Array<int>::newFlatInstance(small);
+            assertEquals("small", (long) systemHeapCount, (long) FastHeap::getSystemHeapCount());
+            const int large = (int) (FastHeap::MAX_BLOCK_SIZE / sizeof(int)) * 4;
+            Array<int> largeInts = Array<int>::newFlatInstance(large);
+            assertEquals("large", (long) systemHeapCount + 1, (long) FastHeap::getSystemHeapCount());
+            int nonZero = 0;
+            largeInts.forEachSegment(0, large, [&](int* segment, int n) {
+                for (int i = 0; i < n; ++i)
+                    nonZero += (segment[i] != 0);
+            });
+            ints.forEachSegment(0, small, [&](int* segment, int n) {
+                for (int i = 0; i < n; ++i)
+                    nonZero += (segment[i] != 0);
+            });
+            assertEquals(0L, (long) nonZero);
+            int live = Counted::live();
+            {
+                Array<Counted> counted = Array<Counted>::newFlatInstance(large);
+                assertEquals((long) large, (long) (Counted::live() - live));
+                counted.setLength(large + 1); // Converted to a fractal array.
+                assertEquals((long) blocksCapacity(large + 1), (long) (Counted::live() - live));
+            }
+            assertEquals("released", (long) live, (long) Counted::live());
+        }
+
+    };
+
+    CLASS_BASE(ArrayTest, TestCase)
+
+    TEST(testGrowthAllocatesOnDemand)
+    TEST(testShrinkAndRegrow)
+    TEST(testClone)
+    TEST(testPrimitiveElements)
+    TEST(testFlatInstances)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("ArrayTest");
+        tests.addTest(new testGrowthAllocatesOnDemand());
+        tests.addTest(new testShrinkAndRegrow());
+        tests.addTest(new testClone());
+        tests.addTest(new testPrimitiveElements());
+        tests.addTest(new testFlatInstances());
+        return tests;
+    }
+
+};
+
+}
+}
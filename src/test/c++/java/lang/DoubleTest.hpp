@@ -0,0 +1,146 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Double.hpp"
+#include "java/lang/Float.hpp"
+#include "java/lang/NumberFormatException.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Tests of Double::parseDouble and Float::parseFloat (same parser): signs, malformed inputs and correct rounding
+ * around the exact fast path cutoff (the C library is the reference).
+ *
+ * @version 7.0
+ */
+class DoubleTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+
+        static double parse(const String& str) {
+            return Double::parseDouble(str);
+        }
+
+        static float parseFloat(const String& str) {
+            return Float::parseFloat(str);
+        }
+
+        /** Asserts that parsing the specified string throws NumberFormatException. */
+        static void assertInvalid(const String& str) {
+            try {
+                Double::parseDouble(str);
+            } catch (NumberFormatException&) {
+                return;
+            }
+            fail("NumberFormatException expected for \"" + str + "\"");
+        }
+
+        /** Asserts that the specified string is parsed as the C library does (correctly rounded). */
+        static void assertRounded(const char* str) {
+            assertTrue(str, parse(str) == std::strtod(str, nullptr));
+            assertTrue(str, parseFloat(str) == std::strtof(str, nullptr));
+        }
+
+        void testSigns() {
+            double negativeZero = parse("-0");
+            assertTrue((negativeZero == 0) && std::signbit(negativeZero));
+            assertFalse(std::signbit(parse("+0.0")));
+            assertTrue(std::signbit(parseFloat("-0.0e10")));
+            assertEquals(-2.5, parse("-2.5"), 0.0);
+            assertTrue(std::isinf(parse("-Infinity")) && (parse("-Infinity") < 0));
+            assertTrue(Double::isNaN(parse("+NaN")));
+            assertInvalid("-");
+            assertInvalid("+");
+            assertInvalid("-.");
+            assertInvalid("+-1");
+            assertInvalid("-+1");
+        }
+
+        void testMalformed() {
+            assertInvalid("");
+            assertInvalid("   ");
+            assertInvalid(".");
+            assertInvalid("1 2");
+            assertInvalid("1. 5");
+            assertInvalid("1e 5");
+            assertInvalid("1e");
+            assertInvalid("e5");
+            assertInvalid("1.5.2");
+            assertInvalid("1.5fd");
+            assertInvalid("0x1.8"); // Binary exponent mandatory.
+            assertInvalid("nan");
+            assertInvalid("Infinityx");
+            assertEquals(1.5, parse(" \t1.5\n "), 0.0); // Leading and trailing whitespaces trimmed.
+            assertEquals(3.0, parse("0x1.8p1"), 0.0);
+            assertEquals(1.5, parse("1.5f"), 0.0);
+        }
+
+        void testOverflowAndUnderflow() {
+            assertTrue(parse("1.7976931348623157E308") == 1.7976931348623157E308);
+            assertTrue(std::isinf(parse("1.8E308")));
+            assertTrue(std::isinf(parse("-1e99999999999")));
+            assertTrue(parse("4.9E-324") == 4.9E-324);
+            assertTrue(parse("2E-324") == 0.0);
+            assertTrue(parse("1e-99999999999") == 0.0);
+            assertTrue(std::isinf(parseFloat("3.5E38")));
+            assertRounded("1.7976931348623158E308"); // Halfway to the next (infinite) value.
+            assertRounded("2.4703282292062328E-324"); // Just above half the smallest subnormal.
+        }
+
+        /** Mantissas of 16 to 20 digits around the exact fast path (2^53, 19 digits accumulated). */
+        void testFastPathCutoff() {
+            assertRounded("9007199254740992");
+            assertRounded("9007199254740993"); // 2^53 + 1, halfway (rounds to even).
+            assertRounded("9007199254740995");
+            assertRounded("9007199254740993e-5");
+            assertRounded("9007199254740992e22");
+            assertRounded("900719925474099e23"); // Scaled into the exact range.
+            assertRounded("1234567890123456789");
+            assertRounded("9999999999999999999");
+            assertRounded("12345678901234567890");
+            assertRounded("99999999999999999999");
+            assertRounded("18446744073709551615");
+            assertRounded("18446744073709551616");
+            assertRounded("0.1234567890123456789");
+            assertRounded("1234567890123456789e-19");
+            assertRounded("1234567890123456789012e-3");
+            assertRounded("9223372036854775807.5");
+            assertRounded("1.0000000000000002220446049250313080847263336181640625"); // 1 + ulp/2 (tie).
+            assertRounded("1e22");
+            assertRounded("1e23");
+            assertRounded("16777217"); // 2^24 + 1 (float tie).
+            assertRounded("16777219");
+        }
+
+    };
+
+    CLASS_BASE(DoubleTest, TestCase)
+
+    TEST(testSigns)
+    TEST(testMalformed)
+    TEST(testOverflowAndUnderflow)
+    TEST(testFastPathCutoff)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("DoubleTest");
+        tests.addTest(new testSigns());
+        tests.addTest(new testMalformed());
+        tests.addTest(new testOverflowAndUnderflow());
+        tests.addTest(new testFastPathCutoff());
+        return tests;
+    }
+
+};
+
+}
+}
@@ -0,0 +1,97 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Integer.hpp"
+#include "java/lang/NumberFormatException.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Tests of Integer::parseInt: boundaries, signs and malformed inputs.
+ *
+ * @version 7.0
+ */
+class IntegerTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+
+        static long parse(const String& str, int radix = 10) {
+            return Integer::parseInt(str, radix);
+        }
+
+        /** Asserts that parsing the specified string throws NumberFormatException. */
+        static void assertInvalid(const String& str, int radix = 10) {
+            try {
+                Integer::parseInt(str, radix);
+            } catch (NumberFormatException&) {
+                return;
+            }
+            fail("NumberFormatException expected for \"" + str + "\"");
+        }
+
+        void testBoundaries() {
+            assertEquals(2147483647L, parse("2147483647"));
+            assertEquals(2147483647L, parse("+2147483647"));
+            assertEquals(-2147483648L, parse("-2147483648"));
+            assertEquals(2147483647L, parse("7fffffff", 16));
+            assertEquals(-2147483648L, parse("-80000000", 16));
+            assertEquals(-2147483648L, parse("-10000000000000000000000000000000", 2));
+            assertInvalid("2147483648");
+            assertInvalid("-2147483649");
+            assertInvalid("80000000", 16);
+            assertInvalid("9223372036854775808"); // Also overflows a long.
+            assertInvalid("99999999999999999999");
+        }
+
+        void testSigns() {
+            assertEquals(0L, parse("-0"));
+            assertEquals(0L, parse("+0"));
+            assertEquals(-42L, parse("-00042"));
+            assertInvalid("-");
+            assertInvalid("+");
+            assertInvalid("--1");
+            assertInvalid("+-1");
+            assertInvalid("1-");
+        }
+
+        void testMalformed() {
+            assertInvalid("");
+            assertInvalid(" 1"); // No trimming (Java).
+            assertInvalid("1 ");
+            assertInvalid("1 2");
+            assertInvalid("1.0");
+            assertInvalid("12a");
+            assertInvalid("z", 35);
+            assertInvalid("1", 1); // Radix out of range.
+            assertInvalid("1", 37);
+            assertEquals(35L, parse("Z", 36));
+        }
+
+    };
+
+    CLASS_BASE(IntegerTest, TestCase)
+
+    TEST(testBoundaries)
+    TEST(testSigns)
+    TEST(testMalformed)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("IntegerTest");
+        tests.addTest(new testBoundaries());
+        tests.addTest(new testSigns());
+        tests.addTest(new testMalformed());
+        return tests;
+    }
+
+};
+
+}
+}
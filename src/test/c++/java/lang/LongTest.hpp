@@ -0,0 +1,95 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Long.hpp"
+#include "java/lang/NumberFormatException.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Tests of Long::parseLong: boundaries, signs and malformed inputs.
+ *
+ * @version 7.0
+ */
+class LongTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+
+        /** Asserts that parsing the specified string throws NumberFormatException. */
+        static void assertInvalid(const String& str, int radix = 10) {
+            try {
+                Long::parseLong(str, radix);
+            } catch (NumberFormatException&) {
+                return;
+            }
+            fail("NumberFormatException expected for \"" + str + "\"");
+        }
+
+        /** Asserts that the specified string is parsed as the specified value. */
+        static void assertParsed(Type::int64 expected, const String& str, int radix = 10) {
+            assertTrue(str, Long::parseLong(str, radix) == expected);
+        }
+
+        void testBoundaries() {
+            const Type::int64 max = Long::MAX_VALUE;
+            const Type::int64 min = Long::MIN_VALUE;
+            assertParsed(max, "9223372036854775807");
+            assertParsed(max, "+9223372036854775807");
+            assertParsed(min, "-9223372036854775808");
+            assertParsed(max, "7fffffffffffffff", 16);
+            assertParsed(min, "-8000000000000000", 16);
+            assertParsed(max, "1y2p0ij32e8e7", 36);
+            assertInvalid("9223372036854775808");
+            assertInvalid("-9223372036854775809");
+            assertInvalid("92233720368547758070"); // Overflow by multiplication.
+            assertInvalid("8000000000000000", 16);
+            assertInvalid("1y2p0ij32e8e8", 36);
+        }
+
+        void testSigns() {
+            assertParsed(0, "-0");
+            assertParsed(0, "+0");
+            assertParsed(-7, "-0000000000000000000000007");
+            assertInvalid("-");
+            assertInvalid("+");
+            assertInvalid("-+1");
+        }
+
+        void testMalformed() {
+            assertInvalid("");
+            assertInvalid("\t1");
+            assertInvalid("1\n");
+            assertInvalid("12 34");
+            assertInvalid("1L");
+            assertInvalid("0x10");
+            assertInvalid("2", 2);
+        }
+
+    };
+
+    CLASS_BASE(LongTest, TestCase)
+
+    TEST(testBoundaries)
+    TEST(testSigns)
+    TEST(testMalformed)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("LongTest");
+        tests.addTest(new testBoundaries());
+        tests.addTest(new testSigns());
+        tests.addTest(new testMalformed());
+        return tests;
+    }
+
+};
+
+}
+}
@@ -0,0 +1,171 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/StringBuilder.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Tests of the floating point appends: Java representation, shortest digits and round trips (the values are parsed
+ * back with the C library).
+ *
+ * @version 7.0
+ */
+class StringBuilderTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        static const int RANDOM_VALUES = 100000;
+
+        /** Returns the number of significant digits of the specified Java representation. */
+        static int significantDigits(const std::string& str) {
+            int first = -1, last = -1, index = 0;
+            for (char c : str) {
+                if ((c == 'E') || (c == 'e'))
+                    break;
+                if ((c >= '0') && (c <= '9')) {
+                    if ((first < 0) && (c != '0'))
+                        first = index;
+                    if (c != '0')
+                        last = index;
+                    ++index;
+                }
+            }
+            return (first < 0) ? 0 : last - first + 1;
+        }
+
+        template<typename T> static T parse(const char* str) {
+            return (sizeof(T) == sizeof(double)) ? (T) std::strtod(str, nullptr) : (T) std::strtof(str, nullptr);
+        }
+
+        /** Checks that the specified value round-trips and that no decimal with one less digit does (the decimals
+         *  just below and above the value). */
+        template<typename T> void assertShortest(T value) {
+            std::string str = String::valueOf(value).toUTF8();
+            assertTrue(String::valueOf(str + " round trip"), parse<T>(str.c_str()) == value);
+            int digits = significantDigits(str);
+            if (digits <= 2) // At least two digits (Java).
+                return;
+            char rounded[40]; // d.ddde-xx with digits - 1 digits.
+            std::snprintf(rounded, sizeof(rounded), "%.*e", digits - 2, (double) value);
+            long long mantissa = 0;
+            const char* p = rounded;
+            for (; (*p != 'e'); ++p) {
+                if ((*p >= '0') && (*p <= '9')) // Skips the decimal point.
+                    mantissa = mantissa * 10 + (*p - '0');
+            }
+            int exponent = std::atoi(p + 1) - (digits - 2);
+            for (int delta = -1; delta <= 1; ++delta) {
+                char shorter[40];
+                std::snprintf(shorter, sizeof(shorter), "%llde%d", mantissa + delta, exponent);
+                assertTrue(String::valueOf(str + " shortest"), parse<T>(shorter) != value);
+            }
+        }
+
+        /** Returns the value of the specified bits. */
+        template<typename T, typename Bits> static T fromBits(Bits bits) {
+            T value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        void testDoubleRepresentation() {
+            assertEquals("0.0", String::valueOf(0.0));
+            assertEquals("-0.0", String::valueOf(-0.0));
+            assertEquals("1.0", String::valueOf(1.0));
+            assertEquals("0.1", String::valueOf(0.1));
+            assertEquals("0.3", String::valueOf(0.3));
+            assertEquals("0.30000000000000004", String::valueOf(0.1 + 0.2));
+            assertEquals("100.0", String::valueOf(100.0));
+            assertEquals("-1234.5678", String::valueOf(-1234.5678));
+            assertEquals("9999999.0", String::valueOf(9999999.0));
+            assertEquals("1.0E7", String::valueOf(1e7));
+            assertEquals("0.001", String::valueOf(1e-3));
+            assertEquals("9.999E-4", String::valueOf(9.999e-4));
+            assertEquals("1.0E23", String::valueOf(1e23));
+            assertEquals("6.156563468186638E113", String::valueOf(std::ldexp(1.0, 378))); // Lower bound closer.
+            assertEquals("NaN", String::valueOf(std::numeric_limits<double>::quiet_NaN()));
+            assertEquals("Infinity", String::valueOf(std::numeric_limits<double>::infinity()));
+            assertEquals("-Infinity", String::valueOf(-std::numeric_limits<double>::infinity()));
+        }
+
+        void testDoubleLimits() {
+            assertEquals("1.7976931348623157E308", String::valueOf(std::numeric_limits<double>::max()));
+            assertEquals("-1.7976931348623157E308", String::valueOf(-std::numeric_limits<double>::max()));
+            assertEquals("2.2250738585072014E-308", String::valueOf(std::numeric_limits<double>::min()));
+            assertEquals("2.225073858507201E-308", String::valueOf(fromBits<double>(0x000FFFFFFFFFFFFFULL)));
+            assertEquals("4.9E-324", String::valueOf(std::numeric_limits<double>::denorm_min()));
+            assertEquals("9.9E-324", String::valueOf(fromBits<double>(2ULL))); // Closest two digits.
+            assertEquals("1.5E-323", String::valueOf(fromBits<double>(3ULL)));
+            for (Type::int64 bits = 1; bits < 10000; bits += 7) // Subnormals.
+                assertShortest(fromBits<double>(bits));
+        }
+
+        void testFloatRepresentation() {
+            assertEquals("0.0", String::valueOf(0.0f));
+            assertEquals("-0.0", String::valueOf(-0.0f));
+            assertEquals("0.1", String::valueOf(0.1f));
+            assertEquals("3.4028235E38", String::valueOf(std::numeric_limits<float>::max()));
+            assertEquals("1.1754944E-38", String::valueOf(std::numeric_limits<float>::min())); // Shortest (Java 19).
+            assertEquals("1.4E-45", String::valueOf(std::numeric_limits<float>::denorm_min()));
+            assertEquals("1.0E10", String::valueOf(1e10f));
+            assertEquals("1234567.0", String::valueOf(1234567.0f));
+            assertEquals("NaN", String::valueOf(std::numeric_limits<float>::quiet_NaN()));
+            assertEquals("-Infinity", String::valueOf(-std::numeric_limits<float>::infinity()));
+            for (Type::int32 bits = 1; bits < 10000; bits += 3) // Subnormals.
+                assertShortest(fromBits<float>(bits));
+        }
+
+        /** Random bit patterns (all exponents) and powers of two (asymmetric rounding intervals). */
+        void testShortestRoundTrip() {
+            unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+            for (int i = 0; i < RANDOM_VALUES; ++i) {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                double d = fromBits<double>(seed);
+                if (std::isfinite(d))
+                    assertShortest(d);
+                float f = fromBits<float>((unsigned) (seed >> 32));
+                if (std::isfinite(f))
+                    assertShortest(f);
+            }
+            for (int e = -1074; e <= 1023; ++e)
+                assertShortest(std::ldexp(1.0, e));
+            for (int e = -149; e <= 127; ++e)
+                assertShortest(std::ldexp(1.0f, e));
+        }
+
+    };
+
+    CLASS_BASE(StringBuilderTest, TestCase)
+
+    TEST(testDoubleRepresentation)
+    TEST(testDoubleLimits)
+    TEST(testFloatRepresentation)
+    TEST(testShortestRoundTrip)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("StringBuilderTest");
+        tests.addTest(new testDoubleRepresentation());
+        tests.addTest(new testDoubleLimits());
+        tests.addTest(new testFloatRepresentation());
+        tests.addTest(new testShortestRoundTrip());
+        return tests;
+    }
+
+};
+
+}
+}
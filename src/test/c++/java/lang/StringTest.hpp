@@ -0,0 +1,68 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <cstring>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/IllegalArgumentException.hpp"
+
+namespace java {
+namespace lang {
+
+/**
+ * Tests of the string literals: the characters are copied (the caller storage is neither shared nor modified) and
+ * non-ASCII characters are rejected.
+ *
+ * @version 7.0
+ */
+class StringTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+
+        /** Literals do not share the characters they are created from. */
+        void testLiteralCopy() {
+            char chars[] = "Hello World";
+            String::Literal literal(chars);
+            std::strcpy(chars, "Modified");
+            String str = literal;
+            assertEquals("Hello World", str);
+            assertEquals(11L, (long) str.length());
+            assertEquals("Hello", str.substring(0, 5));
+            assertTrue(str == (String) literal); // Same immortal value.
+        }
+
+        /** Non-ASCII characters are rejected. */
+        void testLiteralNonAscii() {
+            bool thrown = false;
+            try {
+                String::Literal literal("caf\xC3\xA9");
+            } catch (const IllegalArgumentException&) {
+                thrown = true;
+            }
+            assertTrue(thrown);
+        }
+
+    };
+
+    CLASS_BASE(StringTest, TestCase)
+
+    TEST(testLiteralCopy)
+    TEST(testLiteralNonAscii)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("StringTest");
+        tests.addTest(new testLiteralCopy());
+        tests.addTest(new testLiteralNonAscii());
+        return tests;
+    }
+
+};
+
+}
+}
@@ -0,0 +1,190 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <unordered_map>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/String.hpp"
+#include "java/util/FastMap.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * Tests of FastMap: lookups and updates while the entries are migrated from the previous table, removals shifting
+ * the colliding entries backward, and random operations against std::unordered_map.
+ *
+ * @version 7.0
+ */
+class FastMapTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        static const int RANDOM_OPERATIONS = 50000;
+
+        /** Few distinct hash codes: long probe sequences wrapping around the end of the table. */
+        struct Colliding {
+            static int hashOf(int key) {
+                return key % 16;
+            }
+            static bool areEqual(int left, int right) {
+                return left == right;
+            }
+        };
+
+        /** Asserts that the specified map holds the expected entries. */
+        template<class EQ> static void assertContent(const String& message,
+                const std::unordered_map<int, int>& expected, const FastMap<int, int, EQ>& map) {
+            assertEquals(message + " size", (long) expected.size(), (long) map.size());
+            int mismatches = 0;
+            for (const auto& entry : expected)
+                mismatches += !map.containsKey(entry.first) || (map.get(entry.first) != entry.second);
+            int visited = 0;
+            map.forEach([&](int key, int value) {
+                auto i = expected.find(key);
+                mismatches += (i == expected.end()) || (i->second != value);
+                ++visited;
+            });
+            assertEquals(message + " mismatches", 0L, (long) mismatches);
+            assertEquals(message + " forEach", (long) expected.size(), (long) visited);
+        }
+
+        /** Each insertion is checked against all the previous ones: right after each resize most entries are
+         *  still in the previous table (migrated a few slots per update). */
+        void testIncrementalMigration() {
+            FastMap<int, int> map = new FastMap<int, int>::Value();
+            std::unordered_map<int, int> expected;
+            for (int key = 0; key < 3000; ++key) {
+                map.put(key * 7, key);
+                expected[key * 7] = key;
+                int mismatches = 0;
+                for (int i = 0; i <= key; ++i)
+                    mismatches += (map.get(i * 7) != i);
+                assertEquals(String::valueOf(key), 0L, (long) mismatches);
+                assertFalse(map.containsKey(key * 7 + 1));
+            }
+            assertContent("inserted", expected, map);
+        }
+
+        /** Updates and removals right after a resize, of entries not migrated yet (found in the previous table). */
+        void testUpdatesDuringMigration() {
+            const int size = 769; // The 769th insertion doubles the capacity (1024 to 2048).
+            FastMap<int, int> map = new FastMap<int, int>::Value();
+            std::unordered_map<int, int> expected;
+            for (int key = 0; key < size; ++key) {
+                map.put(key, key);
+                expected[key] = key;
+            }
+            for (int key = size - 1; key >= 0; key -= 3) { // Updates.
+                assertEquals((long) key, (long) map.put(key, -key));
+                expected[key] = -key;
+            }
+            for (int key = size - 2; key >= 0; key -= 3) { // Removals.
+                assertEquals((long) key, (long) map.remove(key));
+                expected.erase(key);
+                assertFalse(map.containsKey(key));
+            }
+            assertContent("updated", expected, map);
+            for (int key = size; key < 2 * size; ++key) { // Completes the migration and resizes again.
+                map.put(key, key);
+                expected[key] = key;
+            }
+            assertContent("grown", expected, map);
+        }
+
+        /** Removals within clusters shift the following entries backward; the remaining entries are still found
+         *  (and the removed ones are not). */
+        void testBackwardShiftErase() {
+            FastMap<int, int, Colliding> map = new FastMap<int, int, Colliding>::Value();
+            std::unordered_map<int, int> expected;
+            for (int key = 0; key < 300; ++key) {
+                map.put(key, key + 1);
+                expected[key] = key + 1;
+            }
+            int order[] = { 0, 16, 299, 150, 1, 17, 33, 283 }; // Heads, middles and tails of clusters.
+            for (int key : order) {
+                assertEquals((long) key + 1, (long) map.remove(key));
+                expected.erase(key);
+                assertContent("removed " + String::valueOf(key), expected, map);
+            }
+            for (int key = 0; key < 300; key += 2) { // Every other entry of each cluster.
+                map.remove(key);
+                expected.erase(key);
+            }
+            assertContent("sparse", expected, map);
+            for (int key = 0; key < 300; key += 2) { // Reinserted in the freed slots.
+                map.put(key, -key);
+                expected[key] = -key;
+            }
+            assertContent("reinserted", expected, map);
+        }
+
+        /** Random insertions, updates and removals (the table grows while the entries are migrated). */
+        void testRandomOperations() {
+            FastMap<int, int> map = new FastMap<int, int>::Value();
+            std::unordered_map<int, int> expected;
+            unsigned int seed = 12345;
+            for (int i = 0; i < RANDOM_OPERATIONS; ++i) {
+                seed = seed * 1103515245 + 12345;
+                int random = (int) (seed >> 8);
+                int key = (random >> 2) % 4096;
+                auto entry = expected.find(key);
+                int previous = (entry != expected.end()) ? entry->second : 0;
+                if (random % 4 != 0) {
+                    assertEquals((long) previous, (long) map.put(key, i));
+                    expected[key] = i;
+                } else {
+                    assertEquals((long) previous, (long) map.remove(key));
+                    expected.erase(key);
+                }
+                if (i % 5000 == 0)
+                    assertContent(String::valueOf(i), expected, map);
+            }
+            assertContent("random", expected, map);
+        }
+
+        /** Object keys and values, absent keys (null or default values); the map is reusable once cleared. */
+        void testObjectEntries() {
+            FastMap<String, String> map = new FastMap<String, String>::Value();
+            for (int i = 0; i < 100; ++i)
+                map.put(String::valueOf(i), String::valueOf(-i));
+            assertEquals("-42", map.get(String::valueOf(42)));
+            assertEquals("-42", map.remove(String::valueOf(42)));
+            assertTrue(map.get(String::valueOf(42)) == nullptr);
+            assertEquals("none", map.getOrDefault(String::valueOf(42), "none"));
+            assertEquals(99L, (long) map.size());
+            map.clear();
+            assertTrue(map.isEmpty());
+            assertEquals("{}", map.toString());
+            map.put("a", "b");
+            assertEquals("{a=b}", map.toString());
+        }
+
+    };
+
+    CLASS_BASE(FastMapTest, TestCase)
+
+    TEST(testIncrementalMigration)
+    TEST(testUpdatesDuringMigration)
+    TEST(testBackwardShiftErase)
+    TEST(testRandomOperations)
+    TEST(testObjectEntries)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("FastMapTest");
+        tests.addTest(new testIncrementalMigration());
+        tests.addTest(new testUpdatesDuringMigration());
+        tests.addTest(new testBackwardShiftErase());
+        tests.addTest(new testRandomOperations());
+        tests.addTest(new testObjectEntries());
+        return tests;
+    }
+
+};
+
+}
+}
@@ -0,0 +1,232 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <deque>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/String.hpp"
+#include "java/util/FastTable.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * Tests of FastTable against std::deque: growth of wrapped-around buffers, insertions and deletions shifting the
+ * elements toward the head or the tail across segment boundaries, and random operations.
+ *
+ * @version 7.0
+ */
+class FastTableTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        static const int SEGMENT_SIZE = Array<int>::SEGMENT_SIZE;
+        static const int RANDOM_OPERATIONS = 50000;
+
+        /** Asserts that the specified table holds the expected elements (random access and forEach). */
+        static void assertContent(const String& message, const std::deque<int>& expected,
+                const FastTable<int>& table) {
+            assertEquals(message + " size", (long) expected.size(), (long) table.size());
+            int mismatches = 0;
+            for (int i = 0; i < (int) expected.size(); ++i)
+                mismatches += (table.get(i) != expected[i]);
+            assertEquals(message + " get", 0L, (long) mismatches);
+            int index = 0;
+            table.forEach([&](int element) {
+                mismatches += (index >= (int) expected.size()) || (element != expected[index]);
+                ++index;
+            });
+            assertEquals(message + " forEach", 0L, (long) mismatches);
+        }
+
+        /** Returns a table (and its expected content) whose buffer is wrapped around in the middle of a segment. */
+        static FastTable<int> wrappedTable(int size, std::deque<int>& expected) {
+            FastTable<int> table = new FastTable<int>::Value();
+            for (int i = 0; i < size; ++i) {
+                if (i % 3 == 0) {
+                    table.addFirst(i);
+                    expected.push_front(i);
+                } else {
+                    table.addLast(i);
+                    expected.push_back(i);
+                }
+            }
+            return table;
+        }
+
+        /** Few elements appended and many prepended: the wrapped part at the start of the buffer is the smaller
+         *  one when the table is full. */
+        void testGrowthMovingWrappedPart() {
+            FastTable<int> table = new FastTable<int>::Value();
+            std::deque<int> expected;
+            for (int i = 0; i < 20 * SEGMENT_SIZE + 5; ++i) {
+                if (i % 8 == 0) {
+                    table.addLast(i);
+                    expected.push_back(i);
+                } else {
+                    table.addFirst(i);
+                    expected.push_front(i);
+                }
+                if ((i & (i - 1)) == 0) // Powers of two.
+                    assertContent(String::valueOf(i), expected, table);
+            }
+            assertContent("grown", expected, table);
+        }
+
+        /** Many elements appended and few prepended: the part from the head to the end of the buffer is the
+         *  smaller one when the table is full. */
+        void testGrowthMovingHeadPart() {
+            FastTable<int> table = new FastTable<int>::Value();
+            std::deque<int> expected;
+            for (int i = 0; i < 20 * SEGMENT_SIZE + 5; ++i) {
+                if (i % 8 == 0) {
+                    table.addFirst(i);
+                    expected.push_front(i);
+                } else {
+                    table.addLast(i);
+                    expected.push_back(i);
+                }
+                if ((i & (i - 1)) == 0)
+                    assertContent(String::valueOf(i), expected, table);
+            }
+            assertContent("grown", expected, table);
+        }
+
+        /** Insertions and deletions near the head (elements before shifted) and near the tail (elements after
+         *  shifted), at and around the segment boundaries. */
+        void testShifts() {
+            std::deque<int> expected;
+            FastTable<int> table = wrappedTable(6 * SEGMENT_SIZE + 3, expected);
+            int offsets[] = { 0, 1, SEGMENT_SIZE - 1, SEGMENT_SIZE, SEGMENT_SIZE + 1, 2 * SEGMENT_SIZE + 7 };
+            int value = -1;
+            for (int offset : offsets) {
+                for (int towardTail = 0; towardTail < 2; ++towardTail) {
+                    int index = towardTail ? (int) expected.size() - offset : offset;
+                    table.add(index, value);
+                    expected.insert(expected.begin() + index, value--);
+                    assertContent("add " + String::valueOf(index), expected, table);
+                }
+            }
+            for (int offset : offsets) {
+                for (int towardTail = 0; towardTail < 2; ++towardTail) {
+                    int index = towardTail ? (int) expected.size() - 1 - offset : offset;
+                    assertEquals((long) expected[index], (long) table.remove(index));
+                    expected.erase(expected.begin() + index);
+                    assertContent("remove " + String::valueOf(index), expected, table);
+                }
+            }
+        }
+
+        /** Random operations at both ends and in the middle. */
+        void testRandomOperations() {
+            FastTable<int> table = new FastTable<int>::Value();
+            std::deque<int> expected;
+            unsigned int seed = 12345;
+            for (int i = 0; i < RANDOM_OPERATIONS; ++i) {
+                seed = seed * 1103515245 + 12345;
+                int random = (int) (seed >> 8);
+                int size = (int) expected.size();
+                switch (random % 8) {
+                case 0:
+                case 1:
+                    table.addLast(i);
+                    expected.push_back(i);
+                    break;
+                case 2:
+                    table.addFirst(i);
+                    expected.push_front(i);
+                    break;
+                case 3: {
+                    int index = (random >> 3) % (size + 1);
+                    table.add(index, i);
+                    expected.insert(expected.begin() + index, i);
+                    break;
+                }
+                case 4:
+                    if (size > 0) {
+                        int index = (random >> 3) % size;
+                        assertEquals((long) expected[index], (long) table.remove(index));
+                        expected.erase(expected.begin() + index);
+                    }
+                    break;
+                case 5:
+                    if (size > 0) {
+                        assertEquals((long) expected.front(), (long) table.removeFirst());
+                        expected.pop_front();
+                    }
+                    break;
+                case 6:
+                    if (size > 0) {
+                        assertEquals((long) expected.back(), (long) table.removeLast());
+                        expected.pop_back();
+                    }
+                    break;
+                default:
+                    if (size > 0) {
+                        int index = (random >> 3) % size;
+                        assertEquals((long) expected[index], (long) table.set(index, i));
+                        expected[index] = i;
+                    }
+                }
+                if (i % 1000 == 0)
+                    assertContent(String::valueOf(i), expected, table);
+            }
+            assertContent("random", expected, table);
+        }
+
+        /** Removals at both ends release the elements; the table is reusable once cleared. */
+        void testRemoveFirstLastAndClear() {
+            FastTable<String> table = new FastTable<String>::Value();
+            for (int i = 0; i < 3 * SEGMENT_SIZE; ++i)
+                table.addFirst(String::valueOf(i));
+            assertEquals(String::valueOf(3 * SEGMENT_SIZE - 1), table.removeFirst());
+            assertEquals("0", table.removeLast());
+            assertEquals(String::valueOf(3 * SEGMENT_SIZE - 2), table.getFirst());
+            assertEquals("1", table.getLast());
+            table.clear();
+            assertTrue(table.isEmpty());
+            assertEquals("[]", table.toString());
+            try {
+                table.removeFirst();
+                fail("NoSuchElementException expected");
+            } catch (NoSuchElementException&) {
+            }
+            try {
+                table.get(0);
+                fail("IndexOutOfBoundsException expected");
+            } catch (IndexOutOfBoundsException&) {
+            }
+            table.add("a");
+            table.addFirst("b");
+            table.add(1, "c");
+            assertEquals("[b, c, a]", table.toString());
+        }
+
+    };
+
+    CLASS_BASE(FastTableTest, TestCase)
+
+    TEST(testGrowthMovingWrappedPart)
+    TEST(testGrowthMovingHeadPart)
+    TEST(testShifts)
+    TEST(testRandomOperations)
+    TEST(testRemoveFirstLastAndClear)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("FastTableTest");
+        tests.addTest(new testGrowthMovingWrappedPart());
+        tests.addTest(new testGrowthMovingHeadPart());
+        tests.addTest(new testShifts());
+        tests.addTest(new testRandomOperations());
+        tests.addTest(new testRemoveFirstLastAndClear());
+        return tests;
+    }
+
+};
+
+}
+}
@@ -0,0 +1,210 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/String.hpp"
+#include "java/util/SparseArray.hpp"
+
+namespace java {
+namespace util {
+
+/**
+ * Tests of SparseArray against std::map: range removals (subtree sizes), ceiling and floor searches, and inner
+ * nodes collapsing when left with a single child.
+ *
+ * @version 7.0
+ */
+class SparseArrayTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        typedef std::uint64_t Index;
+
+        /** An element counting its live instances (leaves released). */
+        class Counted : public Object {
+        public:
+            class Value : public Object::Value {
+            public:
+                const int value;
+
+                Value(int value) :
+                        value(value) {
+                    ++live();
+                }
+                ~Value() {
+                    --live();
+                }
+            };
+
+            CLASS(Counted)
+
+            static int& live() {
+                static int count = 0;
+                return count;
+            }
+
+            int value() const {
+                return this_<Value>()->value;
+            }
+        };
+
+        /** Returns pseudo-random indices clustered at several levels (shared prefixes of various lengths). */
+        static Index nextIndex(Index& seed) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            Index random = seed >> 16;
+            switch (seed >> 62) {
+            case 0:
+                return random & 0xFF; // Dense.
+            case 1:
+                return 0x12340000 + (random & 0xFFFF);
+            case 2:
+                return (random & 0xF) << 60 | (random & 0xF0); // Spread across the highest digit.
+            default:
+                return random;
+            }
+        }
+
+        /** Asserts that the specified array holds the expected elements (in order). */
+        static void assertContent(const String& message, const std::map<Index, int>& expected,
+                const SparseArray<int, Index>& array) {
+            assertEquals(message + " size", (long) expected.size(), (long) array.size());
+            auto i = expected.begin();
+            int mismatches = 0;
+            array.forEach([&](Index index, int element) {
+                mismatches += (i == expected.end()) || (i->first != index) || (i->second != element);
+                if (i != expected.end())
+                    ++i;
+            });
+            assertEquals(message + " mismatches", 0L, (long) mismatches);
+            assertTrue(message + " all visited", i == expected.end());
+        }
+
+        /** Ranges within and across subtrees; the counts returned rely on the subtree sizes maintained by the
+         *  insertions and removals. */
+        void testRemoveRange() {
+            SparseArray<int, Index> array = new SparseArray<int, Index>::Value();
+            std::map<Index, int> expected;
+            Index seed = 42;
+            for (int round = 0; round < 200; ++round) {
+                for (int i = 0; i < 50; ++i) {
+                    Index index = nextIndex(seed);
+                    array.set(index, round);
+                    expected[index] = round;
+                }
+                for (int i = 0; i < 10; ++i) {
+                    Index index = nextIndex(seed);
+                    array.remove(index);
+                    expected.erase(index);
+                }
+                Index first = nextIndex(seed);
+                Index last = first + (nextIndex(seed) >> (round % 64));
+                if (last < first)
+                    last = std::numeric_limits<Index>::max();
+                auto from = expected.lower_bound(first);
+                auto to = expected.upper_bound(last);
+                long removed = (long) std::distance(from, to);
+                expected.erase(from, to);
+                assertEquals(String::valueOf(round), removed, (long) array.removeRange(first, last));
+                assertContent(String::valueOf(round), expected, array);
+            }
+            assertEquals(0L, (long) array.removeRange(5, 4)); // Empty range.
+            long all = (long) expected.size();
+            assertEquals(all, (long) array.removeRange(0, std::numeric_limits<Index>::max()));
+            assertTrue(array.isEmpty());
+        }
+
+        /** Searches between, at and beyond the indices (including the limits of the index type). */
+        void testCeilingAndFloor() {
+            SparseArray<int, Index> array = new SparseArray<int, Index>::Value();
+            std::map<Index, int> expected;
+            Index result;
+            const Index max = std::numeric_limits<Index>::max();
+            assertFalse(array.ceilingIndex(0, result));
+            assertFalse(array.floorIndex(max, result));
+            Index seed = 7;
+            for (int i = 0; i < 2000; ++i) {
+                Index index = nextIndex(seed);
+                array.set(index, i);
+                expected[index] = i;
+            }
+            int mismatches = 0;
+            for (int i = 0; i < 20000; ++i) {
+                Index index = nextIndex(seed);
+                auto near = expected.lower_bound(index);
+                if ((i % 2 != 0) && (near != expected.end()))
+                    index = near->first - (i % 4 == 1 ? 0 : 1); // At or just before an index.
+                if (i < 4)
+                    index = (i < 2) ? 0 : max;
+                auto ceiling = expected.lower_bound(index);
+                bool found = array.ceilingIndex(index, result);
+                mismatches += (found != (ceiling != expected.end())) || (found && (result != ceiling->first));
+                auto floor = expected.upper_bound(index);
+                found = array.floorIndex(index, result);
+                mismatches += (found != (floor != expected.begin())) || (found && (result != (--floor)->first));
+            }
+            assertEquals(0L, (long) mismatches);
+            assertEquals((long) expected.begin()->first, (long) array.firstIndex());
+            assertEquals((long) expected.rbegin()->first, (long) array.lastIndex());
+        }
+
+        /** Inner nodes left with a single child are replaced by it (the remaining elements are still found) and
+         *  the leaves removed are released. */
+        void testCollapse() {
+            int live = Counted::live();
+            {
+                SparseArray<Counted> array = new SparseArray<Counted>::Value();
+                array.set(0x10, new Counted::Value(1));
+                array.set(0x20, new Counted::Value(2));
+                array.set(0x2F, new Counted::Value(3)); // Inner node 0x2_ under the root.
+                assertEquals(2L, (long) array.remove(0x20).value());
+                assertEquals(3L, (long) array.get(0x2F).value()); // Collapsed into the root.
+                assertEquals(1L, (long) array.remove(0x10).value());
+                assertEquals(0x2FL, (long) array.firstIndex()); // Single leaf.
+                assertEquals(0x2FL, (long) array.lastIndex());
+                array.set(0x2E, new Counted::Value(4)); // Splits again.
+                array.set(0xFFFFFFFF, new Counted::Value(5));
+                assertEquals(3L, (long) array.size());
+                assertEquals(2L, (long) array.removeRange(0x2E, 0x2F)); // Whole subtree.
+                assertEquals(0xFFFFFFFFL, (long) array.firstIndex());
+                assertEquals(5L, (long) array.get(0xFFFFFFFF).value());
+                for (unsigned int i = 0; i < 1000; ++i)
+                    array.set(i * 37, new Counted::Value((int) i));
+                assertEquals(500L, (long) array.removeRange(0, 37 * 499));
+                for (unsigned int i = 500; i < 1000; i += 2)
+                    array.remove(i * 37);
+                assertEquals(251L, (long) array.size());
+                assertEquals((long) Counted::live() - live, (long) array.size());
+                for (unsigned int i = 501; i < 1000; i += 2)
+                    assertEquals((long) i, (long) array.get(i * 37).value());
+            }
+            assertEquals("released", (long) live, (long) Counted::live());
+        }
+
+    };
+
+    CLASS_BASE(SparseArrayTest, TestCase)
+
+    TEST(testRemoveRange)
+    TEST(testCeilingAndFloor)
+    TEST(testCollapse)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("SparseArrayTest");
+        tests.addTest(new testRemoveRange());
+        tests.addTest(new testCeilingAndFloor());
+        tests.addTest(new testCollapse());
+        return tests;
+    }
+
+};
+
+}
+}
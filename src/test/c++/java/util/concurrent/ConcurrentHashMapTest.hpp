@@ -0,0 +1,161 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <atomic>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Integer.hpp"
+#include "java/lang/String.hpp"
+#include "java/util/concurrent/ConcurrentHashMap.hpp"
+#include "java/util/concurrent/ConcurrentTests.hpp"
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * Stress tests of ConcurrentHashMap: concurrent updates and retrievals while the table is transferred, and
+ * atomicity of conditional updates.
+ *
+ * @version 7.0
+ */
+class ConcurrentHashMapTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        static const int THREADS = 4;
+        static const int KEYS = 20000; // Per thread.
+
+        /** Each thread inserts, reads back and removes its own keys, the table grows meanwhile (it never shrinks). */
+        void testConcurrentUpdates() {
+            ConcurrentHashMap<int, int> map = new ConcurrentHashMap<int, int>::Value();
+            std::atomic<int> mismatches(0);
+            int errors = runConcurrently(THREADS, [&](int thread) {
+                int first = thread * KEYS;
+                for (int round = 0; round < 3; ++round) {
+                    for (int key = first; key < first + KEYS; ++key)
+                        map.put(key, key + round);
+                    for (int key = first; key < first + KEYS; ++key) {
+                        if (map.get(key) != key + round)
+                            ++mismatches;
+                    }
+                    for (int key = first; key < first + KEYS; key += 2) {
+                        if (map.remove(key) != key + round)
+                            ++mismatches;
+                    }
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertEquals("mismatches", 0, mismatches.load());
+            assertEquals(THREADS * KEYS / 2, map.size());
+            for (int key = 0; key < THREADS * KEYS; ++key)
+                assertEquals(key % 2 != 0, map.containsKey(key));
+        }
+
+        /** More threads than stripes replace and remove a few shared keys; the nodes unlinked by a thread are
+         *  reclaimed by the others sharing its stripe while readers still traverse the bins. */
+        void testSharedStripes() {
+            const int threads = 2 * FastHeap::MAX_CPU;
+            const int keys = 16;
+            ConcurrentHashMap<int, String> map = new ConcurrentHashMap<int, String>::Value();
+            std::atomic<int> mismatches(0);
+            int errors = runConcurrently(threads, [&](int thread) {
+                for (int i = 0; i < 2000; ++i) {
+                    int key = (thread + i) % keys;
+                    if ((i & 3) == 3)
+                        map.remove(key);
+                    else
+                        map.put(key, String::valueOf(key * 1000 + thread));
+                    String value = map.get((key + 1) % keys);
+                    if ((value != nullptr) && (Integer::parseInt(value) / 1000 != (key + 1) % keys))
+                        ++mismatches;
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertEquals("mismatches", 0, mismatches.load());
+            for (int key = 0; key < keys; ++key) {
+                String value = map.get(key);
+                assertTrue((value == nullptr) || (Integer::parseInt(value) / 1000 == key));
+            }
+        }
+
+        /** Readers always find the keys inserted beforehand while writers force table transfers. */
+        void testRetrievalsDuringTransfer() {
+            ConcurrentHashMap<String, String> map = new ConcurrentHashMap<String, String>::Value();
+            for (int i = 0; i < KEYS; ++i) {
+                String key = String::valueOf(i);
+                map.put(key, key);
+            }
+            std::atomic<int> writers(THREADS / 2);
+            std::atomic<int> mismatches(0);
+            int errors = runConcurrently(THREADS, [&](int thread) {
+                if (thread < THREADS / 2) { // Writer.
+                    for (int i = 0; i < KEYS * 4; ++i) {
+                        String key = String::valueOf(KEYS + thread * KEYS * 4 + i);
+                        map.put(key, key);
+                    }
+                    --writers;
+                    return;
+                }
+                while (writers > 0) { // Reader.
+                    for (int i = 0; i < KEYS; i += 7) {
+                        String key = String::valueOf(i);
+                        String value = map.get(key);
+                        if ((value == nullptr) || !value.equals(key))
+                            ++mismatches;
+                    }
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertEquals("mismatches", 0, mismatches.load());
+            assertEquals(KEYS + THREADS / 2 * KEYS * 4, map.size());
+        }
+
+        /** Conditional insertions of the same keys by all threads succeed exactly once per key. */
+        void testConcurrentPutIfAbsent() {
+            ConcurrentHashMap<int, int> map = new ConcurrentHashMap<int, int>::Value();
+            std::atomic<int> inserted(0);
+            std::atomic<int> computed(0);
+            int errors = runConcurrently(THREADS, [&](int thread) {
+                for (int key = 1; key <= KEYS; ++key) {
+                    if (map.putIfAbsent(key, thread + 1) == 0)
+                        ++inserted;
+                    map.computeIfAbsent(-key, [&](int k) {
+                        ++computed;
+                        return k;
+                    });
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertEquals(KEYS, inserted.load());
+            assertEquals(KEYS, computed.load());
+            assertEquals(2 * KEYS, map.size());
+        }
+
+    };
+
+    CLASS_BASE(ConcurrentHashMapTest, TestCase)
+
+    TEST(testConcurrentUpdates)
+    TEST(testSharedStripes)
+    TEST(testRetrievalsDuringTransfer)
+    TEST(testConcurrentPutIfAbsent)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("ConcurrentHashMapTest");
+        tests.addTest(new testConcurrentUpdates());
+        tests.addTest(new testSharedStripes());
+        tests.addTest(new testRetrievalsDuringTransfer());
+        tests.addTest(new testConcurrentPutIfAbsent());
+        return tests;
+    }
+
+};
+
+}
+}
+}
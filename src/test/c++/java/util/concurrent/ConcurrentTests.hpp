@@ -0,0 +1,40 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * Runs the specified task on the specified number of threads (the task receives the thread number) and waits for
+ * their completion; returns the number of tasks which threw an exception. Assertions should be checked once the
+ * threads are joined (by the test thread).
+ */
+template<class Task> int runConcurrently(int threads, Task task) {
+    std::atomic<int> errors(0);
+    std::vector<std::thread> started;
+    for (int i = 0; i < threads; ++i) {
+        started.emplace_back([&task, &errors, i] {
+            try {
+                task(i);
+            } catch (...) {
+                ++errors;
+            }
+        });
+    }
+    for (std::thread& thread : started)
+        thread.join();
+    return errors;
+}
+
+}
+}
+}
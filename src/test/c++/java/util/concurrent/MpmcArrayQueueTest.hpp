@@ -0,0 +1,192 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Exception.hpp"
+#include "java/lang/String.hpp"
+#include "java/lang/Integer.hpp"
+#include "java/util/FastTable.hpp"
+#include "java/util/concurrent/ConcurrentTests.hpp"
+#include "java/util/concurrent/MpmcArrayQueue.hpp"
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * Stress tests of MpmcArrayQueue: several producers and consumers exchange elements through a small queue (often
+ * full or empty); each element must be received exactly once and in order with respect to its producer.
+ *
+ * @version 7.0
+ */
+class MpmcArrayQueueTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        static const int PRODUCERS = 2;
+        static const int CONSUMERS = 2;
+        static const int COUNT = 100000; // Per producer.
+
+        /** Checks that the values received by a consumer are increasing for each producer. */
+        static bool isOrdered(const std::vector<int>& received) {
+            int last[PRODUCERS];
+            for (int& value : last)
+                value = -1;
+            for (int value : received) {
+                int producer = value / COUNT;
+                if (value <= last[producer])
+                    return false;
+                last[producer] = value;
+            }
+            return true;
+        }
+
+        /** Single and batch operations, the consumers alternate between poll and drain. */
+        void testProducersConsumers() {
+            MpmcArrayQueue<int> queue = new MpmcArrayQueue<int>::Value(64);
+            std::vector<std::vector<int>> received(CONSUMERS);
+            std::atomic<int> producing(PRODUCERS);
+            int errors = runConcurrently(PRODUCERS + CONSUMERS, [&](int thread) {
+                if (thread < PRODUCERS) {
+                    int batch[8];
+                    for (int i = 0; i < COUNT;) {
+                        if ((i & 1) != 0) {
+                            if (queue.offer(thread * COUNT + i))
+                                ++i;
+                            else
+                                std::this_thread::yield();
+                            continue;
+                        }
+                        int n = std::min(8, COUNT - i);
+                        for (int j = 0; j < n; ++j)
+                            batch[j] = thread * COUNT + i + j;
+                        int offered = queue.offerAll(batch, n);
+                        i += offered;
+                        if (offered < n)
+                            std::this_thread::yield();
+                    }
+                    --producing;
+                    return;
+                }
+                std::vector<int>& values = received[thread - PRODUCERS];
+                auto consume = [&values](int&& value) {
+                    values.push_back(value);
+                };
+                for (int round = 0;; ++round) {
+                    bool done = (producing == 0);
+                    int value;
+                    if ((round & 1) != 0) {
+                        while (queue.poll(value))
+                            values.push_back(value);
+                    } else {
+                        queue.drain(consume, 16);
+                    }
+                    if (done && queue.isEmpty())
+                        break;
+                    std::this_thread::yield();
+                }
+            });
+            assertEquals("errors", 0, errors);
+            std::vector<int> counts(PRODUCERS * COUNT);
+            for (const std::vector<int>& values : received) {
+                assertTrue("ordered", isOrdered(values));
+                for (int value : values)
+                    ++counts[value];
+            }
+            for (int i = 0; i < PRODUCERS * COUNT; ++i)
+                assertEquals("count of " + String::valueOf(i), 1, counts[i]);
+        }
+
+        /** Object handles transferred to tables (moved, the queue holds no reference once drained). */
+        void testDrainTo() {
+            MpmcArrayQueue<String> queue = new MpmcArrayQueue<String>::Value(32);
+            std::vector<FastTable<String>> tables;
+            for (int i = 0; i < CONSUMERS; ++i)
+                tables.push_back(new FastTable<String>::Value());
+            std::atomic<int> producing(PRODUCERS);
+            int errors = runConcurrently(PRODUCERS + CONSUMERS, [&](int thread) {
+                if (thread < PRODUCERS) {
+                    for (int i = 0; i < COUNT / 10;) {
+                        if (queue.offer(String::valueOf(thread * COUNT + i)))
+                            ++i;
+                        else
+                            std::this_thread::yield();
+                    }
+                    --producing;
+                    return;
+                }
+                for (;;) {
+                    bool done = (producing == 0);
+                    queue.drainTo(tables[thread - PRODUCERS], 8);
+                    if (done && queue.isEmpty())
+                        break;
+                    std::this_thread::yield();
+                }
+            });
+            assertEquals("errors", 0, errors);
+            std::vector<int> counts(PRODUCERS * COUNT);
+            for (FastTable<String>& table : tables) {
+                std::vector<int> values;
+                table.forEach([&values](const String& value) {
+                    values.push_back(Integer::parseInt(value));
+                });
+                assertTrue("ordered", isOrdered(values));
+                for (int value : values)
+                    ++counts[value];
+            }
+            for (int producer = 0; producer < PRODUCERS; ++producer) {
+                for (int i = 0; i < COUNT / 10; ++i)
+                    assertEquals("count", 1, counts[producer * COUNT + i]);
+            }
+        }
+
+        /** A consumer throws: the elements of its batch not yet consumed are discarded, the following ones remain. */
+        void testConsumerThrows() {
+            MpmcArrayQueue<int> queue = new MpmcArrayQueue<int>::Value(16);
+            for (int i = 0; i < 10; ++i)
+                queue.offer(i);
+            int consumed = 0;
+            bool thrown = false;
+            try {
+                queue.drain([&consumed](int&&) {
+                    if (++consumed == 2)
+                        throw Exception("Consumer failure");
+                }, 5);
+            } catch (Exception&) {
+                thrown = true;
+            }
+            assertTrue("thrown", thrown);
+            assertEquals(5, queue.size());
+            assertEquals(5, queue.poll());
+        }
+
+    };
+
+    CLASS_BASE(MpmcArrayQueueTest, TestCase)
+
+    TEST(testProducersConsumers)
+    TEST(testDrainTo)
+    TEST(testConsumerThrows)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("MpmcArrayQueueTest");
+        tests.addTest(new testProducersConsumers());
+        tests.addTest(new testDrainTo());
+        tests.addTest(new testConsumerThrows());
+        return tests;
+    }
+
+};
+
+}
+}
+}
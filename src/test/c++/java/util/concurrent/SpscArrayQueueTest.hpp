@@ -0,0 +1,151 @@
+/*
+ * Javolution - Java(TM) Solution for Real-Time and Embedded Systems
+ * Copyright (C) 2012 - Javolution (http://javolution.org/)
+ * All rights reserved.
+ */
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include "junit/framework/TestCase.hpp"
+#include "junit/framework/TestSuite.hpp"
+#include "java/lang/Exception.hpp"
+#include "java/lang/String.hpp"
+#include "java/util/FastTable.hpp"
+#include "java/util/concurrent/ConcurrentTests.hpp"
+#include "java/util/concurrent/SpscArrayQueue.hpp"
+
+namespace java {
+namespace util {
+namespace concurrent {
+
+/**
+ * Stress tests of SpscArrayQueue: a producer and a consumer exchange elements through a small queue (often full
+ * or empty) mixing single and batch operations; the elements must be received exactly once and in order.
+ *
+ * @version 7.0
+ */
+class SpscArrayQueueTest : public junit::framework::TestCase {
+public:
+    class Value : public junit::framework::TestCase::Value {
+    protected:
+        static const int COUNT = 200000;
+
+        /** Runs the specified producer and consumer concurrently, returns the number of them which threw. */
+        template<class Producer, class Consumer> static int runProducerConsumer(Producer producer, Consumer consumer) {
+            return runConcurrently(2, [&](int thread) {
+                if (thread == 0)
+                    producer();
+                else
+                    consumer();
+            });
+        }
+
+        /** Single and batch operations on both sides. */
+        void testProducerConsumer() {
+            SpscArrayQueue<int> queue = new SpscArrayQueue<int>::Value(64);
+            int next = 0; // The next value expected by the consumer.
+            bool ordered = true;
+            int errors = runProducerConsumer([&] {
+                int batch[16];
+                for (int i = 0; i < COUNT;) {
+                    if ((i & 1) != 0) {
+                        if (queue.offer(i))
+                            ++i;
+                        else
+                            std::this_thread::yield();
+                        continue;
+                    }
+                    int n = std::min(16, COUNT - i);
+                    for (int j = 0; j < n; ++j)
+                        batch[j] = i + j;
+                    int offered = queue.offerAll(batch, n);
+                    i += offered;
+                    if (offered < n)
+                        std::this_thread::yield();
+                }
+            }, [&] {
+                auto consume = [&](int&& value) {
+                    ordered &= (value == next++);
+                };
+                for (int round = 0; next < COUNT; ++round) {
+                    int value;
+                    if ((round & 1) != 0) {
+                        while (queue.poll(value))
+                            consume(std::move(value));
+                    } else {
+                        queue.drain(consume, 24);
+                    }
+                    std::this_thread::yield();
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertTrue("ordered", ordered);
+            assertEquals(COUNT, next);
+            assertTrue(queue.isEmpty());
+        }
+
+        /** Object handles transferred to a table (moved, the queue holds no reference once drained). */
+        void testDrainTo() {
+            SpscArrayQueue<String> queue = new SpscArrayQueue<String>::Value(32);
+            FastTable<String> table = new FastTable<String>::Value();
+            int errors = runProducerConsumer([&] {
+                for (int i = 0; i < COUNT / 10;) {
+                    if (queue.offer(String::valueOf(i)))
+                        ++i;
+                    else
+                        std::this_thread::yield();
+                }
+            }, [&] {
+                while (table.size() < COUNT / 10) {
+                    queue.drainTo(table, 8);
+                    std::this_thread::yield();
+                }
+            });
+            assertEquals("errors", 0, errors);
+            assertEquals(COUNT / 10, table.size());
+            for (int i = 0; i < COUNT / 10; ++i)
+                assertEquals(String::valueOf(i), table.get(i));
+        }
+
+        /** A consumer throws: the elements of its batch not yet consumed are discarded, the following ones remain. */
+        void testConsumerThrows() {
+            SpscArrayQueue<int> queue = new SpscArrayQueue<int>::Value(16);
+            for (int i = 0; i < 10; ++i)
+                queue.offer(i);
+            int consumed = 0;
+            bool thrown = false;
+            try {
+                queue.drain([&consumed](int&&) {
+                    if (++consumed == 2)
+                        throw Exception("Consumer failure");
+                }, 5);
+            } catch (Exception&) {
+                thrown = true;
+            }
+            assertTrue("thrown", thrown);
+            assertEquals(5, queue.size());
+            assertEquals(5, queue.poll());
+        }
+
+    };
+
+    CLASS_BASE(SpscArrayQueueTest, TestCase)
+
+    TEST(testProducerConsumer)
+    TEST(testDrainTo)
+    TEST(testConsumerThrows)
+
+    static junit::framework::TestSuite suite() {
+        junit::framework::TestSuite tests = new junit::framework::TestSuite::Value("SpscArrayQueueTest");
+        tests.addTest(new testProducerConsumer());
+        tests.addTest(new testDrainTo());
+        tests.addTest(new testConsumerThrows());
+        return tests;
+    }
+
+};
+
+}
+}
+}